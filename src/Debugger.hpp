@@ -1,30 +1,85 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <functional>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <sstream>
-#include <unordered_set>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <imgui.h>
 #include <imgui_memory_editor/imgui_memory_editor.h>
 
-#include "./get_bits.hpp"
-#include "./Registers.hpp"
+#include "./core/Breakpoints.hpp"
+#include "./core/ClockHandler.hpp"
+#include "./core/Disassembler.hpp"
+#include "./core/get_bits.hpp"
+#include "./core/MemoryGenerations.hpp"
+#include "./core/Profile.hpp"
+#include "./core/Registers.hpp"
+#include "./core/Trace.hpp"
 
-class Debugger
+class Debugger : public ClockHandler
 {
 private:
     std::shared_ptr<std::array<byte, 0x1000>> memory;
     std::shared_ptr<Registers> registers;
+    std::shared_ptr<const MemoryGenerations> generations;
+
+    // The disassembly of every even address, formatted once and kept until its page of memory is written to
+    std::array<std::string, 0x800> disassembly;
+    std::bitset<0x800> disassembled;
+    std::array<uint32_t, MemoryGenerations::PAGES> disassembled_generations{};
+
+    // What the Chip 8 has executed, counted while profiling is enabled
+    const std::shared_ptr<Profile> profile = std::make_shared<Profile>();
+
+    // The last instructions the Chip 8 executed, recorded while tracing is enabled
+    const std::shared_ptr<Trace> trace = std::make_shared<Trace>();
+    std::atomic<bool> dump_on_break = false;
+    char trace_path[256] = "trace.c8t";
+    uint64_t trace_from = 0;
+    uint64_t trace_to = UINT64_MAX;
 
     MemoryEditor memory_editor;
 
-    // Set of addresses with breakpoints
-    std::unordered_set<addr_t> breakpoints{};
+    // Called from the window thread when the memory editor changes memory, so the Chip 8 can drop anything it cached from it
+    std::function<void(addr_t, size_t)> memory_written;
+
+    // The memory editor's write callback only gets the memory being written, so the debugger drawing it is kept here
+    static inline Debugger *editing_debugger = nullptr;
+
+    static void write_memory(ImU8 *data, size_t offset, ImU8 value)
+    {
+        data[offset] = value;
+        if (editing_debugger && editing_debugger->memory_written)
+            editing_debugger->memory_written(offset, 1);
+    }
+
+    // PC breakpoints, conditions and watchpoints
+    Breakpoints breakpoints;
 
     // If set when a clock starts, a breakpoint will be triggered
-    bool break_next = false;
+    std::atomic<bool> break_next = false;
+
+    // Why execution is stopped, guarded by break_mtx since the window thread shows it
+    std::string break_reason;
+
+    // Inputs for adding conditions and watchpoints
+    char condition_text[64] = "";
+    bool condition_invalid = false;
+    addr_t watch_start = 0;
+    addr_t watch_end = 0;
+    bool watch_read = false;
+    bool watch_write = true;
 
     // The register currently being edited, nullptr if none are being edited
     void *editing_reg;
@@ -32,7 +87,7 @@ private:
     // These are used to handle pausing program execution for breakpoints
     std::mutex break_mtx;
     std::condition_variable break_cv;
-    bool broken;
+    std::atomic<bool> broken{false};
 
     template <uint8_t Digits>
     constexpr const std::string get_register_format() const
@@ -100,312 +155,26 @@ private:
         }
     }
 
-    class Instruction
+    // The text for the instruction at an even address, which only has to be formatted again after its page changes
+    // Instructions at even addresses never straddle pages, so a page's generation covers everything its lines were made from
+    const std::string &disassemble(addr_t addr)
     {
-    public:
-        class Argument
-        {
-        public:
-            enum class Type
-            {
-                GeneralRegister,
-                AddrRegister,
-                DelayTimerRegister,
-                SoundTimerRegister,
-                Key,
-                Font,
-                BCD,
-                Address,
-                Byte,
-                Nibble
-            };
-
-            const Type type;
-            const uint16_t value;
-            const bool dereference;
-
-            constexpr Argument(Type type, uint16_t value = 0, bool dereference = false) : type(type), value(value), dereference(dereference) {}
-
-            operator std::string() const
-            {
-                std::stringstream stream;
-                stream << std::hex << std::uppercase << std::setfill('0');
-
-                if (dereference)
-                    stream
-                        << "[";
-
-                switch (type)
-                {
-                case Type::GeneralRegister:
-                    stream << "V" << value;
-                    break;
-                case Type::AddrRegister:
-                    stream << "I";
-                    break;
-                case Type::DelayTimerRegister:
-                    stream << "DT";
-                    break;
-                case Type::SoundTimerRegister:
-                    stream << "ST";
-                    break;
-                case Type::Key:
-                    stream << "K";
-                    break;
-                case Type::Font:
-                    stream << "F";
-                    break;
-                case Type::BCD:
-                    stream << "B";
-                    break;
-                case Type::Address:
-                    stream << std::setw(3) << value;
-                    break;
-                case Type::Byte:
-                    stream << std::setw(2) << value;
-                    break;
-                case Type::Nibble:
-                    stream << std::setw(1) << value;
-                    break;
-                }
-
-                if (dereference)
-                    stream << "]";
-
-                return stream.str();
-            }
-        };
-
-        const std::string mnemonic;
-        const std::optional<Argument> arg1;
-        const std::optional<Argument> arg2;
-        const std::optional<Argument> arg3;
-
-        Instruction(std::string mnemonic, std::optional<Argument> arg1 = std::nullopt, std::optional<Argument> arg2 = std::nullopt, std::optional<Argument> arg3 = std::nullopt) : mnemonic(mnemonic), arg1(arg1), arg2(arg2), arg3(arg3) {}
-
-        operator std::string() const
+        const size_t page = addr / MemoryGenerations::PAGE_SIZE;
+        const uint32_t generation = generations->get(addr);
+        if (disassembled_generations[page] != generation)
         {
-            std::stringstream stream;
-
-            stream << mnemonic;
-
-            if (arg1)
-                stream << " " << static_cast<std::string>(*arg1);
-
-            if (arg2)
-                stream << ", " << static_cast<std::string>(*arg2);
-
-            if (arg3)
-                stream << ", " << static_cast<std::string>(*arg3);
-
-            return stream.str();
+            disassembled_generations[page] = generation;
+            for (size_t line = page * MemoryGenerations::PAGE_SIZE / 2; line < (page + 1) * MemoryGenerations::PAGE_SIZE / 2; line++)
+                disassembled[line] = false;
         }
-    };
 
-    std::optional<Instruction> disassemble_instruction(inst_t instruction)
-    {
-        // nnn - A 12-bit value, the lowest 12 bits of the instruction
-        const addr_t nnn = get_bits(instruction, 0, 12);
-        // n - A 4-bit value, the lowest 4 bits of the instruction
-        const uint8_t n = get_bits(instruction, 0, 4);
-        // x - A 4-bit value, the lower 4 bits of the high byte of the instruction
-        const uint8_t x = get_bits(instruction, 8, 4);
-        // y - A 4-bit value, the upper 4 bits of the low byte of the instruction
-        const uint8_t y = get_bits(instruction, 4, 4);
-        // kk - An 8-bit value, the lowest 8 bits of the instruction
-        const uint8_t kk = get_bits(instruction, 0, 8);
-
-        // Switch on the most significant nibble of the instruction
-        switch (get_bits(instruction, 12, 4))
+        if (!disassembled[addr / 2])
         {
-        case 0x0:
-            switch (nnn)
-            {
-            case 0x0E0:
-                // 00E0 - CLS
-                return Instruction("CLS");
-                break;
-            case 0x0EE:
-                // 00EE - RET
-                return Instruction("RET");
-                break;
-            }
-            break;
-        case 0x1:
-            // 1nnn - JP addr
-            return Instruction("JP", Instruction::Argument(Instruction::Argument::Type::Address, nnn));
-            break;
-        case 0x2:
-            // 2nnn - CALL addr
-            return Instruction("CALL", Instruction::Argument(Instruction::Argument::Type::Address, nnn));
-            break;
-        case 0x3:
-            // 3xkk - SE Vx, byte
-            return Instruction("SE", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::Byte, kk));
-            break;
-        case 0x4:
-            // 4xkk - SNE Vx, byte
-            return Instruction("SNE", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::Byte, kk));
-            break;
-        case 0x5:
-            // 5xy0 - SE Vx, Vy
-            return Instruction("SE", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-            break;
-        case 0x6:
-            // 6xkk - LD Vx, byte
-            return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::Byte, kk));
-            break;
-        case 0x7:
-            // 7xkk - ADD Vx, byte
-            return Instruction("ADD", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::Byte, kk));
-            break;
-        case 0x8:
-            switch (n)
-            {
-            case 0x0:
-                // 8xy0 - LD Vx, Vy
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0x1:
-                // 8xy1 - OR Vx, Vy
-                return Instruction("OR", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0x2:
-                // 8xy2 - AND Vx, Vy
-                return Instruction("AND", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0x3:
-                // 8xy3 - XOR Vx, Vy
-                return Instruction("XOR", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0x4:
-                // 8xy4 - ADD Vx, Vy
-                return Instruction("ADD", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0x5:
-                // 8xy5 - SUB Vx, Vy
-                return Instruction("SUB", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0x6:
-                // 8xy6 - SHR Vx {, Vy}
-                return Instruction("SHR", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0x7:
-                // 8xy7 - SUBN Vx, Vy
-                return Instruction("SUBN", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            case 0xE:
-                // 8xyE - SHL Vx {, Vy}
-                return Instruction("SHL", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-                break;
-            }
-            break;
-        case 0x9:
-            // 9xy0 - SNE Vx, Vy
-            return Instruction("SNE", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y));
-            break;
-        case 0xA:
-            // Annn - LD I, addr
-            return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::AddrRegister),
-                               Instruction::Argument(Instruction::Argument::Type::Address, nnn));
-            break;
-        case 0xB:
-            // Bnnn - JP V0, addr
-            return Instruction("JP", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, 0),
-                               Instruction::Argument(Instruction::Argument::Type::Address, nnn));
-            break;
-        case 0xC:
-            // Cxkk - RND Vx, byte
-            return Instruction("RND", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::Byte, kk));
-            break;
-        case 0xD:
-            // Dxyn - DRW Vx, Vy, nibble
-            return Instruction("DRW", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                               Instruction::Argument(Instruction::Argument::Type::GeneralRegister, y),
-                               Instruction::Argument(Instruction::Argument::Type::Nibble, n));
-            break;
-        case 0xE:
-            switch (kk)
-            {
-            case 0x9E:
-                // Ex9E - SKP Vx
-                return Instruction("SKP", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            case 0xA1:
-                // ExA1 - SKNP Vx
-                return Instruction("SKNP", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            }
-            break;
-        case 0xF:
-            switch (kk)
-            {
-            case 0x07:
-                // Fx07 - LD Vx, DT
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::DelayTimerRegister));
-                break;
-            case 0x0A:
-                // Fx0A - LD Vx, K
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::Key));
-                break;
-            case 0x15:
-                // Fx15 - LD DT, Vx
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::DelayTimerRegister),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            case 0x18:
-                // Fx18 - LD ST, Vx
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::SoundTimerRegister),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            case 0x1E:
-                // Fx1E - ADD I, Vx
-                return Instruction("ADD", Instruction::Argument(Instruction::Argument::Type::AddrRegister),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            case 0x29:
-                // Fx29 - LD F, Vx
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::Font),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            case 0x33:
-                // Fx33 - LD B, Vx
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::BCD),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            case 0x55:
-                // Fx55 - LD [I], Vx
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::AddrRegister, 0, true),
-                                   Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x));
-                break;
-            case 0x65:
-                // Fx65 - LD Vx, [I]
-                return Instruction("LD", Instruction::Argument(Instruction::Argument::Type::GeneralRegister, x),
-                                   Instruction::Argument(Instruction::Argument::Type::AddrRegister, 0, true));
-                break;
-            }
-            break;
+            std::optional<Instruction> instruction = disassemble_instruction((*memory)[addr] << 8 | (*memory)[addr + 1]);
+            disassembly[addr / 2] = instruction ? static_cast<std::string>(*instruction) : "????";
+            disassembled[addr / 2] = true;
         }
-
-        return std::nullopt;
+        return disassembly[addr / 2];
     }
 
     void draw_disassembly()
@@ -418,21 +187,19 @@ private:
             {
                 for (addr_t addr = clipper.DisplayStart * 2; addr < clipper.DisplayEnd * 2; addr += 2)
                 {
-                    std::optional<Instruction> instruction = disassemble_instruction((*memory)[addr] << 8 | (*memory)[addr + 1]);
-
                     ImGui::TableNextColumn();
 
-                    bool breakpoint = breakpoints.count(addr);
+                    bool breakpoint = breakpoints.has_breakpoint(addr);
                     if (breakpoint)
                         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 0.27, 0, 1));
 
                     ImGui::Bullet();
 
                     if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && ImGui::IsItemHovered())
-                        if (!breakpoint)
-                            breakpoints.insert(addr);
-                        else
-                            breakpoints.erase(addr);
+                    {
+                        breakpoints.set_breakpoint(addr, !breakpoint);
+                        update_armed();
+                    }
 
                     if (breakpoint)
                         ImGui::PopStyleColor();
@@ -445,10 +212,8 @@ private:
                     ImGui::Text("%03X", addr);
 
                     ImGui::TableNextColumn();
-                    if (instruction)
-                        ImGui::Text("%s", static_cast<std::string>(*instruction).c_str());
-                    else
-                        ImGui::Text("????");
+                    const std::string &text = disassemble(addr);
+                    ImGui::TextUnformatted(text.c_str(), text.c_str() + text.size());
 
                     if (current_instruction)
                         ImGui::PopStyleColor();
@@ -458,6 +223,186 @@ private:
         }
     }
 
+    // The text for the instruction at any address, odd addresses aren't cached
+    std::string instruction_text(addr_t addr)
+    {
+        addr &= 0xFFF;
+        if ((addr & 1) == 0)
+            return disassemble(addr);
+
+        std::optional<Instruction> instruction = disassemble_instruction((*memory)[addr] << 8 | (*memory)[(addr + 1) & 0xFFF]);
+        return instruction ? static_cast<std::string>(*instruction) : "????";
+    }
+
+    // Where the program spends its instructions since profiling was enabled or reset
+    void draw_profiler()
+    {
+        static constexpr const size_t ROWS = 12;
+
+        bool enabled = profile->is_enabled();
+        if (ImGui::Checkbox("Profile", &enabled))
+            profile->set_enabled(enabled);
+        ImGui::SameLine();
+        if (ImGui::Button("Reset"))
+            profile->reset();
+
+        struct Loop
+        {
+            addr_t start;
+            addr_t end;
+            uint64_t iterations;
+            uint64_t instructions;
+        };
+
+        std::array<uint64_t, 0x1000> counts;
+        uint64_t total = 0;
+        std::vector<std::pair<uint64_t, addr_t>> hottest;
+        std::vector<std::pair<uint64_t, addr_t>> calls;
+        for (addr_t addr = 0; addr < counts.size(); addr++)
+        {
+            counts[addr] = profile->get_address_count(addr);
+            total += counts[addr];
+            if (counts[addr])
+                hottest.emplace_back(counts[addr], addr);
+            if (const uint64_t called = profile->get_call_count(addr))
+                calls.emplace_back(called, addr);
+        }
+
+        // A jump backwards closes a loop, and every time it's taken is an iteration
+        std::vector<Loop> loops;
+        for (const auto &[count, addr] : hottest)
+        {
+            const inst_t instruction = (*memory)[addr] << 8 | (*memory)[(addr + 1) & 0xFFF];
+            if (instruction >> 12 != 0x1 || (instruction & 0xFFF) > addr)
+                continue;
+
+            Loop loop{static_cast<addr_t>(instruction & 0xFFF), addr, count, 0};
+            for (addr_t inside = loop.start; inside <= loop.end; inside++)
+                loop.instructions += counts[inside];
+            loops.push_back(loop);
+        }
+
+        const auto by_count = [](const std::pair<uint64_t, addr_t> &a, const std::pair<uint64_t, addr_t> &b)
+        { return a.first > b.first; };
+        const auto top = [&](std::vector<std::pair<uint64_t, addr_t>> &rows)
+        {
+            std::partial_sort(rows.begin(), rows.begin() + std::min(rows.size(), ROWS), rows.end(), by_count);
+            rows.resize(std::min(rows.size(), ROWS));
+        };
+        top(hottest);
+        top(calls);
+        std::partial_sort(loops.begin(), loops.begin() + std::min(loops.size(), ROWS), loops.end(), [](const Loop &a, const Loop &b)
+                          { return a.instructions > b.instructions; });
+        loops.resize(std::min(loops.size(), ROWS));
+
+        const auto percent = [total](uint64_t count)
+        { return total ? 100.0 * count / total : 0.0; };
+
+        const uint64_t sprites = profile->get_sprites();
+        ImGui::Text("%llu instructions, %llu sprites drawn, %.1f pixels per sprite", static_cast<unsigned long long>(total), static_cast<unsigned long long>(sprites),
+                    sprites ? static_cast<double>(profile->get_sprite_pixels()) / sprites : 0.0);
+
+        if (ImGui::BeginTable("hottest", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            for (const auto &[count, addr] : hottest)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%03X", addr);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(count));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", percent(count));
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", instruction_text(addr).c_str());
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::Text("Loops");
+        if (ImGui::BeginTable("loops", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            for (const Loop &loop : loops)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%03X-%03X", loop.start, loop.end);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu iterations", static_cast<unsigned long long>(loop.iterations));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", percent(loop.instructions));
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", instruction_text(loop.start).c_str());
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::Text("Calls");
+        if (ImGui::BeginTable("calls", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            for (const auto &[count, addr] : calls)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%03X", addr);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu calls", static_cast<unsigned long long>(count));
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", instruction_text(addr).c_str());
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::Text("Instructions");
+        if (ImGui::BeginTable("ops", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            std::vector<std::pair<uint64_t, addr_t>> ops;
+            for (size_t op = 0; op < Profile::OP_NAMES.size(); op++)
+            {
+                if (const uint64_t count = profile->get_op_count(static_cast<Op>(op)))
+                    ops.emplace_back(count, op);
+            }
+            std::sort(ops.begin(), ops.end(), by_count);
+
+            for (const auto &[count, op] : ops)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", Profile::OP_NAMES[op]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(count));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", percent(count));
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    // Recording executed instructions and dumping them to a file, which chip8_trace prints
+    void draw_trace()
+    {
+        bool enabled = trace->is_enabled();
+        if (ImGui::Checkbox("Record", &enabled))
+            trace->set_enabled(enabled);
+        ImGui::SameLine();
+        bool dump = dump_on_break;
+        if (ImGui::Checkbox("Dump on break", &dump))
+            dump_on_break = dump;
+
+        if (ImGui::InputText("File", trace_path, sizeof(trace_path)))
+            trace->set_path(trace_path);
+        if (ImGui::InputScalar("From cycle", ImGuiDataType_U64, &trace_from) | ImGui::InputScalar("To cycle", ImGuiDataType_U64, &trace_to))
+            trace->set_range(trace_from, trace_to);
+
+        // While stopped the Chip 8 can't dump it, but it also isn't recording
+        if (ImGui::Button("Dump"))
+        {
+            if (broken)
+                trace->dump();
+            else
+                trace->request_dump();
+        }
+        ImGui::SameLine();
+        ImGui::Text("%llu instructions recorded, %llu dumps%s", static_cast<unsigned long long>(trace->get_recorded()), static_cast<unsigned long long>(trace->get_dumps()),
+                    trace->last_dump_failed() ? ", the last one failed" : "");
+    }
+
     // Handle drawing buttons for debugging operations, like step instruction, continue, etc.
     void draw_operations()
     {
@@ -468,6 +413,86 @@ private:
 
         if (ImGui::Button("Step Instruction"))
             step_instruction();
+
+        std::unique_lock<std::mutex> lock(break_mtx);
+        if (broken)
+        {
+            ImGui::SameLine();
+            ImGui::Text("Stopped: %s", break_reason.c_str());
+        }
+    }
+
+    // Conditions like "V3 == 0x10 && I > 0xE00", and memory ranges to break on reads or writes to
+    void draw_breakpoints()
+    {
+        ImGui::SetNextItemWidth(200);
+        const bool entered = ImGui::InputText("##condition", condition_text, sizeof(condition_text), ImGuiInputTextFlags_EnterReturnsTrue);
+        ImGui::SameLine();
+        if (ImGui::Button("Add Condition") || entered)
+        {
+            condition_invalid = !breakpoints.add_condition(condition_text);
+            if (!condition_invalid)
+                condition_text[0] = '\0';
+            update_armed();
+        }
+        if (condition_invalid)
+            ImGui::TextColored(ImVec4(1, 0.27, 0, 1), "Conditions look like V3 == 0x10 && I > 0xE00");
+
+        const std::vector<std::string> conditions = breakpoints.get_conditions();
+        for (size_t idx = 0; idx < conditions.size(); idx++)
+        {
+            ImGui::PushID(static_cast<int>(idx));
+            if (ImGui::SmallButton("X"))
+            {
+                breakpoints.remove_condition(idx);
+                update_armed();
+            }
+            ImGui::PopID();
+            ImGui::SameLine();
+            ImGui::Text("%s", conditions[idx].c_str());
+        }
+
+        ImGui::Separator();
+
+        ImGui::SetNextItemWidth(60);
+        ImGui::InputScalar("##watch_start", ImGuiDataType_U16, &watch_start, nullptr, nullptr, "%03X", ImGuiInputTextFlags_CharsHexadecimal);
+        ImGui::SameLine();
+        ImGui::Text("-");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(60);
+        ImGui::InputScalar("##watch_end", ImGuiDataType_U16, &watch_end, nullptr, nullptr, "%03X", ImGuiInputTextFlags_CharsHexadecimal);
+        ImGui::SameLine();
+        ImGui::Checkbox("Read", &watch_read);
+        ImGui::SameLine();
+        ImGui::Checkbox("Write", &watch_write);
+        ImGui::SameLine();
+        if (ImGui::Button("Add Watchpoint") && (watch_read || watch_write))
+        {
+            const addr_t start = std::min<addr_t>(watch_start, 0xFFF);
+            breakpoints.add_watchpoint({start, std::clamp<addr_t>(watch_end, start, 0xFFF), watch_read, watch_write});
+            update_armed();
+        }
+
+        const std::vector<Watchpoint> watchpoints = breakpoints.get_watchpoints();
+        for (size_t idx = 0; idx < watchpoints.size(); idx++)
+        {
+            ImGui::PushID(static_cast<int>(0x1000 + idx));
+            if (ImGui::SmallButton("X"))
+            {
+                breakpoints.remove_watchpoint(idx);
+                update_armed();
+            }
+            ImGui::PopID();
+            ImGui::SameLine();
+            const Watchpoint &watchpoint = watchpoints[idx];
+            ImGui::Text("%03X-%03X %s%s", watchpoint.start, watchpoint.end, watchpoint.read ? "R" : "", watchpoint.write ? "W" : "");
+        }
+    }
+
+    // on_clock only needs to run while something could stop execution
+    void update_armed()
+    {
+        armed = break_next || breakpoints.any();
     }
 
     void continue_exec()
@@ -478,28 +503,54 @@ private:
     void step_instruction()
     {
         break_next = true;
+        update_armed();
         continue_exec();
     }
 
 public:
-    void attach(std::shared_ptr<std::array<byte, 0x1000>> memory, std::shared_ptr<Registers> registers, bool break_next)
+    void attach(std::shared_ptr<std::array<byte, 0x1000>> memory, std::shared_ptr<Registers> registers, std::shared_ptr<const MemoryGenerations> generations, bool break_next,
+                std::function<void(addr_t, size_t)> memory_written)
     {
         this->memory = memory;
         this->registers = registers;
+        this->generations = generations;
+        disassembled.reset();
         this->break_next = break_next;
+        this->memory_written = memory_written;
+        memory_editor.WriteFn = write_memory;
+        update_armed();
     }
 
-    void on_clock()
+    [[nodiscard]] const std::shared_ptr<Profile> &get_profile() const
     {
-        if (break_next || breakpoints.count(registers->pc_reg))
-        {
-            broken = true;
+        return profile;
+    }
 
-            break_next = false;
+    [[nodiscard]] const std::shared_ptr<Trace> &get_trace() const
+    {
+        return trace;
+    }
 
-            std::unique_lock<std::mutex> lock(break_mtx);
-            break_cv.wait(lock);
-        }
+    virtual void on_clock()
+    {
+        const addr_t pc = registers->pc_reg & 0xFFF;
+        const inst_t instruction = (*memory)[pc] << 8 | (*memory)[(pc + 1) & 0xFFF];
+        std::string reason;
+        if (break_next.exchange(false))
+            reason = "Step";
+        else if (!breakpoints.check(*registers, instruction, reason))
+            return;
+
+        update_armed();
+
+        // Steps are asked for, so there's nothing to look back on
+        if (dump_on_break && reason != "Step")
+            trace->dump();
+
+        std::unique_lock<std::mutex> lock(break_mtx);
+        break_reason = std::move(reason);
+        broken = true;
+        break_cv.wait(lock);
 
         broken = false;
     }
@@ -517,8 +568,21 @@ public:
             draw_disassembly();
         }
 
+        if (ImGui::CollapsingHeader("Breakpoints"))
+            draw_breakpoints();
+
+        if (ImGui::CollapsingHeader("Profiler"))
+            draw_profiler();
+
+        if (ImGui::CollapsingHeader("Trace"))
+            draw_trace();
+
         if (ImGui::CollapsingHeader("Memory", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            editing_debugger = this;
             memory_editor.DrawContents(memory.get(), memory->size());
+            editing_debugger = nullptr;
+        }
 
         ImGui::End();
     }
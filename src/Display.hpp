@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <SFML/Graphics.hpp>
+
+#include "./core/Chip8.hpp"
+#include "./core/Framebuffer.hpp"
+#include "./core/get_bits.hpp"
+
+// Draws the Chip 8 display as a single texture scaled up to the window
+class Display : public sf::Drawable
+{
+public:
+    static constexpr const size_t PIXEL_SIZE = 10;
+
+private:
+    static constexpr const uint8_t ON = 0xFF;
+    static constexpr const uint8_t OFF = 0x00;
+
+    const std::shared_ptr<Chip8> chip8;
+
+    // One texel per Chip 8 pixel
+    sf::Texture texture;
+    sf::Sprite sprite;
+
+    // The rows that are currently in the texture, used to only upload rows that changed
+    Framebuffer uploaded{};
+
+    // A single row of RGBA texels
+    std::array<uint8_t, Framebuffer::WIDTH * 4> row_pixels{};
+
+    void upload_row(size_t y, uint64_t row)
+    {
+        for (size_t x = 0; x < Framebuffer::WIDTH; x++)
+        {
+            const uint8_t value = get_bits(row, Framebuffer::WIDTH - 1 - x, 1) ? ON : OFF;
+            row_pixels[x * 4] = value;
+            row_pixels[x * 4 + 1] = value;
+            row_pixels[x * 4 + 2] = value;
+            row_pixels[x * 4 + 3] = 0xFF;
+        }
+
+        texture.update(row_pixels.data(), Framebuffer::WIDTH, 1, 0, y);
+    }
+
+public:
+    Display(std::shared_ptr<Chip8> chip8) : chip8(chip8)
+    {
+        texture.create(Framebuffer::WIDTH, Framebuffer::HEIGHT);
+        for (size_t y = 0; y < Framebuffer::HEIGHT; y++)
+            upload_row(y, 0);
+
+        sprite.setTexture(texture);
+        sprite.setScale(PIXEL_SIZE, PIXEL_SIZE);
+    }
+
+    // Upload the rows of the display that changed since the last update
+    // This has to be called from the thread that owns the window
+    void update()
+    {
+        const Framebuffer screen = chip8->get_framebuffer();
+
+        for (size_t y = 0; y < Framebuffer::HEIGHT; y++)
+        {
+            if (screen.rows[y] != uploaded.rows[y])
+                upload_row(y, screen.rows[y]);
+        }
+
+        uploaded = screen;
+    }
+
+    virtual void draw(sf::RenderTarget &target, sf::RenderStates states) const
+    {
+        target.draw(sprite, states);
+    }
+};
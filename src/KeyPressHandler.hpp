@@ -1,9 +0,0 @@
-#pragma once
-
-#include <cstdint>
-
-class KeyPressHandler
-{
-public:
-    virtual void handle_key_press(uint8_t key) = 0;
-};
\ No newline at end of file
@@ -4,14 +4,14 @@
 #include <SFML/Graphics.hpp>
 
 #include "./Key.hpp"
-#include "./KeyPressHandler.hpp"
+#include "./core/KeypadState.hpp"
 
 class Keypad : public sf::Drawable
 {
 private:
     std::array<Key, 16> keys;
     std::shared_ptr<sf::Font> font;
-    std::vector<std::shared_ptr<KeyPressHandler>> handlers;
+    std::shared_ptr<KeypadState> state;
 
 public:
     // Some constants
@@ -19,7 +19,7 @@ public:
     static constexpr const std::array<char, 16> KEY_CHARACTER{'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
     static constexpr const std::array<uint8_t, 16> KEY_DRAW_ORDER{1, 2, 3, 0xC, 4, 5, 6, 0xD, 7, 8, 9, 0xE, 0xA, 0, 0xB, 0xF};
 
-    Keypad() : font(std::make_shared<sf::Font>())
+    Keypad() : font(std::make_shared<sf::Font>()), state(std::make_shared<KeypadState>())
     {
         font->loadFromFile("../fonts/PressStart2P-vaV7.ttf");
 
@@ -30,11 +30,6 @@ public:
         }
     }
 
-    void add_key_press_handler(std::shared_ptr<KeyPressHandler> handler)
-    {
-        handlers.push_back(handler);
-    }
-
     constexpr void handle_key_event(sf::Event event)
     {
         // Turn the key code into the key
@@ -44,22 +39,21 @@ public:
         if (key == 0xFF)
             return;
 
-        // Modify the key state appropriately
+        // Modify the key state appropriately, the emulator core picks up the change from the event queue
+        // Holding a key down repeats KeyPressed, only the first one is queued
+        // A press is dropped if the queue is full while the core is stalled, but a release never is, so keys can't get stuck down
         switch (event.type)
         {
         case sf::Event::KeyPressed:
+            if (!keys[key].get_down())
+                state->push(key, true);
             keys[key].set_down(true);
             break;
         case sf::Event::KeyReleased:
             keys[key].set_down(false);
+            state->push(key, false);
             break;
         }
-
-        // Notify the handlers
-        for (const std::shared_ptr<KeyPressHandler> &handler : handlers)
-        {
-            handler->handle_key_press(key);
-        }
     }
 
     [[nodiscard]] inline bool is_key_down(uint8_t key) const
@@ -67,6 +61,12 @@ public:
         return keys[key].get_down();
     }
 
+    // The key state the emulator core reads from
+    [[nodiscard]] const std::shared_ptr<KeypadState> &get_state() const
+    {
+        return state;
+    }
+
     virtual void draw(sf::RenderTarget &target, sf::RenderStates states) const
     {
         for (const Key &key : keys)
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./core/types.hpp"
+
+// A file mapped read only into memory, unmapped when this is destroyed
+class MappedFile
+{
+private:
+    const byte *mapped = nullptr;
+    size_t length = 0;
+
+public:
+    MappedFile() = default;
+
+    // Check is_open to see if it worked, empty files can't be mapped
+    MappedFile(const std::string &path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED)
+            {
+                mapped = static_cast<const byte *>(address);
+                length = info.st_size;
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept : mapped(other.mapped), length(other.length)
+    {
+        other.mapped = nullptr;
+        other.length = 0;
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        std::swap(mapped, other.mapped);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        if (mapped)
+            munmap(const_cast<byte *>(mapped), length);
+    }
+
+    [[nodiscard]] bool is_open() const
+    {
+        return mapped != nullptr;
+    }
+
+    [[nodiscard]] const byte *data() const
+    {
+        return mapped;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return length;
+    }
+};
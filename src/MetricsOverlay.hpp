@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <imgui.h>
+
+#include "./core/Metrics.hpp"
+#include "./core/Scheduler.hpp"
+
+// Live numbers on how fast the emulator and the window are running, drawn over the top left corner of the window
+// Rates are worked out every half second, so the numbers stay readable
+class MetricsOverlay
+{
+private:
+    static constexpr const std::chrono::milliseconds INTERVAL{500};
+
+    const std::shared_ptr<Metrics> metrics;
+    bool visible = false;
+
+    Metrics::Sample last;
+    Metrics::Rates rates;
+
+public:
+    MetricsOverlay(std::shared_ptr<Metrics> metrics) : metrics(metrics), last(metrics->sample()) {}
+
+    void toggle()
+    {
+        visible = !visible;
+
+        // Rates start over, rather than averaging over the time the overlay was hidden
+        last = metrics->sample();
+        rates = Metrics::Rates();
+    }
+
+    void draw(const Scheduler &scheduler)
+    {
+        if (!visible)
+            return;
+
+        const Metrics::Sample now = metrics->sample();
+        if (now.time - last.time >= INTERVAL)
+        {
+            rates = Metrics::rates(last, now);
+            last = now;
+        }
+
+        ImGui::SetNextWindowPos(ImVec2(10, 10));
+        ImGui::SetNextWindowBgAlpha(0.6f);
+        ImGui::Begin("Metrics", nullptr,
+                     ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+                         ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoInputs);
+
+        const uint32_t target = scheduler.get_instructions_per_second();
+        ImGui::Text("%.0f instructions per second", rates.instructions_per_second);
+        ImGui::Text("%.1f%% of the %u target%s", 100.0 * rates.instructions_per_second / target, target, scheduler.get_turbo() ? ", turbo" : "");
+        ImGui::Text("%.1f timer ticks per second", rates.timer_ticks_per_second);
+        ImGui::Text("Frame %.2f ms, %.0f frames per second", rates.frame_ms, rates.window_frames_per_second);
+        ImGui::Text("Display %.2f ms, %.0f draw calls per frame", rates.draw_ms, rates.draw_calls_per_frame);
+        ImGui::Text("Framebuffer waits %.0f per second, %.3f ms", rates.framebuffer_waits_per_second, rates.framebuffer_wait_ms);
+
+        ImGui::End();
+    }
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+#include "./Program.hpp"
+#include "./RomCache.hpp"
+
+// Downloads every program in a list into the ROM cache in the background
+// All the downloads share one curl multi handle on a single thread, with at most a fixed number of them in flight at once
+// Programs that are already cached are skipped unless the cache revalidates
+class Prefetcher
+{
+public:
+    static constexpr const size_t DEFAULT_CONNECTIONS = 8;
+
+private:
+    // A download in flight
+    struct Transfer
+    {
+        std::string url;
+        RomCache::Entry cached;
+        bool has_cached = false;
+        RomCache::Response response;
+        CURL *curl = nullptr;
+        curl_slist *headers = nullptr;
+    };
+
+    const RomCache cache;
+    std::vector<std::string> urls;
+    const size_t connections;
+
+    std::atomic<size_t> finished{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<bool> stopping{false};
+
+    std::thread thread;
+
+    void run()
+    {
+        CURLM *multi = curl_multi_init();
+        if (!multi)
+        {
+            failed = urls.size() - finished;
+            finished = urls.size();
+            return;
+        }
+        curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(connections));
+
+        std::deque<std::string> pending(urls.begin(), urls.end());
+        std::vector<std::unique_ptr<Transfer>> active;
+
+        while (!stopping && (!pending.empty() || !active.empty()))
+        {
+            // Keep as many downloads in flight as allowed
+            while (!pending.empty() && active.size() < connections)
+            {
+                std::unique_ptr<Transfer> transfer = std::make_unique<Transfer>();
+                transfer->url = std::move(pending.front());
+                pending.pop_front();
+
+                std::vector<byte> rom;
+                transfer->has_cached = cache.lookup(transfer->url, rom, &transfer->cached);
+                if (transfer->has_cached && !cache.get_revalidate())
+                {
+                    finished++;
+                    continue;
+                }
+
+                transfer->curl = curl_easy_init();
+                if (!transfer->curl)
+                {
+                    failed++;
+                    finished++;
+                    continue;
+                }
+                transfer->headers = cache.prepare(transfer->curl, transfer->url, transfer->has_cached ? &transfer->cached : nullptr, transfer->response);
+                curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer.get());
+                curl_multi_add_handle(multi, transfer->curl);
+                active.push_back(std::move(transfer));
+            }
+
+            int running;
+            curl_multi_perform(multi, &running);
+
+            // Finished downloads make room for pending ones, which shouldn't have to wait for the next poll
+            bool freed = false;
+            int queued;
+            while (CURLMsg *message = curl_multi_info_read(multi, &queued))
+            {
+                if (message->msg != CURLMSG_DONE)
+                    continue;
+
+                Transfer *transfer;
+                curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &transfer);
+                RomCache::finish(message->easy_handle, message->data.result, transfer->response);
+
+                // A server that can't be reached still leaves a cached copy usable
+                if (transfer->response.error.empty() && !transfer->response.not_modified)
+                {
+                    if (!cache.store(transfer->url, transfer->response.body, transfer->response.validators))
+                        failed++;
+                }
+                else if (!transfer->has_cached)
+                {
+                    failed++;
+                }
+                finished++;
+
+                curl_multi_remove_handle(multi, transfer->curl);
+                release(*transfer);
+                freed = true;
+                active.erase(std::find_if(active.begin(), active.end(), [transfer](const std::unique_ptr<Transfer> &other)
+                                          { return other.get() == transfer; }));
+            }
+
+            // Wake up regularly to notice being stopped
+            if (!active.empty() && !(freed && !pending.empty()))
+                curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+        }
+
+        for (std::unique_ptr<Transfer> &transfer : active)
+        {
+            curl_multi_remove_handle(multi, transfer->curl);
+            release(*transfer);
+        }
+        curl_multi_cleanup(multi);
+    }
+
+    static void release(Transfer &transfer)
+    {
+        curl_slist_free_all(transfer.headers);
+        curl_easy_cleanup(transfer.curl);
+    }
+
+public:
+    // Starts downloading right away
+    Prefetcher(const RomCache &cache, const std::vector<Program> &programs, size_t connections = DEFAULT_CONNECTIONS)
+        : cache(cache), connections(std::max<size_t>(connections, 1))
+    {
+        for (const Program &program : programs)
+            urls.push_back(program.path);
+        thread = std::thread([this]
+                             { run(); });
+    }
+
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+
+    // Downloads in flight are abandoned
+    ~Prefetcher()
+    {
+        stopping = true;
+        wait();
+    }
+
+    // Wait for every download to finish
+    void wait()
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+
+    // The number of programs that are done, whether they were downloaded, already cached or failed
+    [[nodiscard]] size_t get_finished() const
+    {
+        return finished;
+    }
+
+    // The number of programs that couldn't be downloaded
+    [[nodiscard]] size_t get_failed() const
+    {
+        return failed;
+    }
+
+    [[nodiscard]] size_t get_total() const
+    {
+        return urls.size();
+    }
+
+    [[nodiscard]] bool done() const
+    {
+        return finished == urls.size();
+    }
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+#include <strings.h>
+
+#include "./core/types.hpp"
+#include "./files.hpp"
+#include "./MappedFile.hpp"
+#include "./Sha256.hpp"
+
+// Where downloaded ROMs are kept so they only ever have to be downloaded once
+// ROMs are stored in objects/ named by the SHA-256 of their contents, and each URL has an entry in urls/ named by the SHA-256 of the URL
+// An entry holds the hash of the ROM downloaded from the URL and the validators the server sent with it, so it can be revalidated cheaply
+// Files are written to a temporary name and renamed into place, so any number of threads or processes can share a cache
+class RomCache
+{
+public:
+    // What's known about a URL that's been downloaded before
+    struct Entry
+    {
+        std::string rom_hash;
+        std::string etag;
+        std::string last_modified;
+    };
+
+    // The outcome of asking the server for a URL
+    struct Response
+    {
+        std::vector<byte> body;
+        Entry validators;
+        long status = 0;
+        // Set when the server says the cached copy is still good
+        bool not_modified = false;
+        // Set when nothing usable came back
+        std::string error;
+    };
+
+private:
+    std::filesystem::path directory;
+
+    // A local directory standing in for the remote host, ROMs are read from it by the last part of their URL
+    std::string mirror;
+
+    // Ask the server whether cached ROMs changed before using them, instead of trusting them forever
+    bool revalidate = false;
+
+    [[nodiscard]] std::filesystem::path entry_path(const std::string &url) const
+    {
+        return directory / "urls" / Sha256::hex(url);
+    }
+
+    [[nodiscard]] std::filesystem::path object_path(const std::string &rom_hash) const
+    {
+        return directory / "objects" / rom_hash;
+    }
+
+    [[nodiscard]] bool read_entry(const std::string &url, Entry &entry) const
+    {
+        std::ifstream stream(entry_path(url));
+        return stream && getline(stream, entry.rom_hash) && getline(stream, entry.etag) && getline(stream, entry.last_modified) && entry.rom_hash.size() == 64;
+    }
+
+    // Keep the validators from the headers of the final response, redirects send headers of their own first
+    static size_t header_callback(char *ptr, size_t size, size_t nmemb, Entry *validators)
+    {
+        const std::string header(ptr, size * nmemb);
+        const auto value = [&](size_t name_length)
+        {
+            const size_t start = header.find_first_not_of(' ', name_length);
+            const size_t end = header.find_last_not_of("\r\n");
+            return start == std::string::npos || end < start ? std::string() : header.substr(start, end - start + 1);
+        };
+
+        if (!strncasecmp(header.c_str(), "HTTP/", 5))
+            *validators = Entry();
+        else if (!strncasecmp(header.c_str(), "ETag:", 5))
+            validators->etag = value(5);
+        else if (!strncasecmp(header.c_str(), "Last-Modified:", 14))
+            validators->last_modified = value(14);
+        return size * nmemb;
+    }
+
+public:
+    RomCache(std::filesystem::path directory) : directory(std::move(directory)) {}
+
+    // Append a piece of a download to its body, curl calls this as pieces arrive
+    static size_t write_callback(char *ptr, size_t size, size_t nmemb, std::vector<byte> *body)
+    {
+        body->insert(body->end(), ptr, ptr + size * nmemb);
+        return size * nmemb;
+    }
+
+    // $CHIP8_CACHE_DIR, or a directory in the user's cache directory
+    [[nodiscard]] static std::filesystem::path default_directory()
+    {
+        if (const char *directory = std::getenv("CHIP8_CACHE_DIR"); directory && *directory)
+            return directory;
+        if (const char *cache = std::getenv("XDG_CACHE_HOME"); cache && *cache)
+            return std::filesystem::path(cache) / "chip8-roms";
+        if (const char *home = std::getenv("HOME"); home && *home)
+            return std::filesystem::path(home) / ".cache" / "chip8-roms";
+        return "rom_cache";
+    }
+
+    // The cache programs use unless they're given another, set up from the environment
+    // $CHIP8_ROM_MIRROR sets the mirror and setting $CHIP8_REVALIDATE turns revalidation on
+    [[nodiscard]] static RomCache &shared()
+    {
+        static RomCache cache = []
+        {
+            RomCache cache(default_directory());
+            if (const char *mirror = std::getenv("CHIP8_ROM_MIRROR"))
+                cache.set_mirror(mirror);
+            cache.set_revalidate(std::getenv("CHIP8_REVALIDATE") != nullptr);
+            return cache;
+        }();
+        return cache;
+    }
+
+    void set_directory(std::filesystem::path directory)
+    {
+        this->directory = std::move(directory);
+    }
+
+    void set_mirror(std::string mirror)
+    {
+        this->mirror = std::move(mirror);
+    }
+
+    void set_revalidate(bool revalidate)
+    {
+        this->revalidate = revalidate;
+    }
+
+    [[nodiscard]] bool get_revalidate() const
+    {
+        return revalidate;
+    }
+
+    // Where a URL is actually downloaded from, which is inside the mirror when there is one
+    [[nodiscard]] std::string source_url(const std::string &url) const
+    {
+        if (mirror.empty())
+            return url;
+
+        // The last part of the URL is already percent encoded, which file:// URLs expect too
+        const size_t slash = url.find_last_of('/');
+        return "file://" + std::filesystem::absolute(mirror).string() + "/" + (slash == std::string::npos ? url : url.substr(slash + 1));
+    }
+
+    // Set up an easy handle to download a URL into response, conditionally when cached is given
+    // The headers have to be freed with curl_slist_free_all once the transfer is done
+    [[nodiscard]] curl_slist *prepare(CURL *curl, const std::string &url, const Entry *cached, Response &response) const
+    {
+        const std::string source = source_url(url);
+        curl_easy_setopt(curl, CURLOPT_URL, source.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response.body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response.validators);
+
+        curl_slist *headers = nullptr;
+        if (cached && !cached->etag.empty())
+            headers = curl_slist_append(headers, ("If-None-Match: " + cached->etag).c_str());
+        if (cached && !cached->last_modified.empty())
+            headers = curl_slist_append(headers, ("If-Modified-Since: " + cached->last_modified).c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        return headers;
+    }
+
+    // Fill in how a transfer set up with prepare went
+    static void finish(CURL *curl, CURLcode result, Response &response)
+    {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status);
+        if (result != CURLE_OK)
+            response.error = curl_easy_strerror(result);
+        else if (response.status == 304)
+            response.not_modified = true;
+        // Protocols other than HTTP, like file://, have no status
+        else if (response.status != 0 && (response.status < 200 || response.status >= 300))
+            response.error = "HTTP status " + std::to_string(response.status);
+        else if (response.body.empty())
+            response.error = "Empty response";
+    }
+
+    // Download a URL right away
+    [[nodiscard]] Response fetch(const std::string &url, const Entry *cached) const
+    {
+        Response response;
+        CURL *curl = curl_easy_init();
+        if (!curl)
+        {
+            response.error = "Couldn't start a download";
+            return response;
+        }
+
+        curl_slist *headers = prepare(curl, url, cached, response);
+        finish(curl, curl_easy_perform(curl), response);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+        return response;
+    }
+
+    // Get the ROM downloaded from a URL without touching the network
+    // Returns false if it hasn't been downloaded or its cached copy is damaged
+    bool lookup(const std::string &url, std::vector<byte> &rom, Entry *entry = nullptr) const
+    {
+        Entry found;
+        if (!read_entry(url, found))
+            return false;
+
+        const MappedFile file(object_path(found.rom_hash).string());
+        if (!file.is_open() || Sha256::hex(file.data(), file.size()) != found.rom_hash)
+            return false;
+
+        rom.assign(file.data(), file.data() + file.size());
+        if (entry)
+            *entry = std::move(found);
+        return true;
+    }
+
+    // Remember what was downloaded from a URL, returns whether it was written
+    bool store(const std::string &url, const std::vector<byte> &rom, const Entry &validators) const
+    {
+        const std::string rom_hash = Sha256::hex(rom.data(), rom.size());
+        const std::string entry = rom_hash + "\n" + validators.etag + "\n" + validators.last_modified + "\n";
+        return write_file_atomically(object_path(rom_hash), rom.data(), rom.size()) && write_file_atomically(entry_path(url), entry.data(), entry.size());
+    }
+
+    // Get the ROM at a URL, from the cache when it's there and the network otherwise
+    // When revalidating, the server is asked whether the cached copy changed, but it's still used if the server can't be reached
+    // Returns false, with error set, if the ROM couldn't be found anywhere
+    bool load(const std::string &url, std::vector<byte> &rom, std::string &error) const
+    {
+        Entry entry;
+        const bool cached = lookup(url, rom, &entry);
+        if (cached && !revalidate)
+            return true;
+
+        Response response = fetch(url, cached ? &entry : nullptr);
+        if (response.not_modified && cached)
+            return true;
+
+        if (!response.error.empty() || response.not_modified)
+        {
+            if (cached)
+                return true;
+            error = response.error.empty() ? "Not modified, but not cached" : response.error;
+            return false;
+        }
+
+        // Failing to write the cache only means it'll be downloaded again next time
+        store(url, response.body, response.validators);
+        rom = std::move(response.body);
+        return true;
+    }
+};
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "./core/types.hpp"
+#include "./files.hpp"
+#include "./MappedFile.hpp"
+#include "./Sha256.hpp"
+
+// The machine a ROM was most likely written for
+enum class Platform : uint8_t
+{
+    Chip8,
+    SuperChip,
+    XoChip,
+};
+
+// Instructions that interpreters disagree about, a bit is set in a ROM's quirks for each kind it uses
+struct Quirk
+{
+    // 8xy6 and 8xyE, whether Vy is shifted into Vx or Vx is shifted in place
+    static constexpr const uint8_t SHIFT = 1 << 0;
+    // Fx55 and Fx65, whether I is left pointing past the registers
+    static constexpr const uint8_t LOAD_STORE = 1 << 1;
+    // Bnnn, whether it jumps relative to V0 or Vx
+    static constexpr const uint8_t JUMP = 1 << 2;
+    // 8xy1, 8xy2 and 8xy3, whether VF is reset
+    static constexpr const uint8_t LOGIC = 1 << 3;
+};
+
+// A local collection of ROMs, described by an index file that's mapped into memory rather than parsed
+// The index is a header, a fixed size entry per ROM and then the names and paths they point to, in the host's byte order
+// A packed library also holds every ROM's bytes, so it's a single file that doesn't need the directories it was built from
+// Opening a library and getting a ROM from it take the same time no matter how many ROMs it holds
+class RomLibrary
+{
+public:
+    // "C8LB" when read as bytes on a little endian host
+    static constexpr const uint32_t MAGIC = 0x424C3843;
+    static constexpr const uint32_t VERSION = 1;
+
+    // A ROM in the library, the strings point into the mapped index
+    struct Rom
+    {
+        std::string_view name;
+        std::string_view path;
+        size_t size = 0;
+        Sha256::Digest hash{};
+        Platform platform = Platform::Chip8;
+        uint8_t quirks = 0;
+        // The ROM's bytes when the library is packed, nullptr otherwise
+        const byte *data = nullptr;
+    };
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    struct Entry
+    {
+        // Offsets are from the start of the file
+        uint32_t name_offset;
+        uint32_t name_length;
+        uint32_t path_offset;
+        uint32_t path_length;
+        // Zero when the library isn't packed
+        uint32_t rom_offset;
+        uint32_t rom_size;
+        Sha256::Digest hash;
+        uint8_t platform;
+        uint8_t quirks;
+        std::array<uint8_t, 6> reserved;
+    };
+
+    static_assert(std::has_unique_object_representations_v<Header> && std::has_unique_object_representations_v<Entry>, "Library files can't have padding");
+
+    MappedFile file;
+
+    [[nodiscard]] const Header &header() const
+    {
+        return *reinterpret_cast<const Header *>(file.data());
+    }
+
+    [[nodiscard]] bool in_file(uint32_t offset, uint32_t length) const
+    {
+        return offset <= file.size() && length <= file.size() - offset;
+    }
+
+public:
+    // Returns false if the file isn't a library of this version, leaving the library empty
+    bool open(const std::string &path)
+    {
+        file = MappedFile(path);
+        if (!file.is_open() || file.size() < sizeof(Header) || header().magic != MAGIC || header().version != VERSION ||
+            header().count > (file.size() - sizeof(Header)) / sizeof(Entry))
+        {
+            file = MappedFile();
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return file.is_open() ? header().count : 0;
+    }
+
+    // Returns false if idx is out of range or the entry points outside of the file
+    bool get(size_t idx, Rom &rom) const
+    {
+        if (idx >= size())
+            return false;
+
+        Entry entry;
+        std::memcpy(&entry, file.data() + sizeof(Header) + idx * sizeof(Entry), sizeof(entry));
+        if (!in_file(entry.name_offset, entry.name_length) || !in_file(entry.path_offset, entry.path_length) || (entry.rom_offset && !in_file(entry.rom_offset, entry.rom_size)))
+            return false;
+
+        const char *chars = reinterpret_cast<const char *>(file.data());
+        rom.name = std::string_view(chars + entry.name_offset, entry.name_length);
+        rom.path = std::string_view(chars + entry.path_offset, entry.path_length);
+        rom.size = entry.rom_size;
+        rom.hash = entry.hash;
+        rom.platform = entry.platform <= static_cast<uint8_t>(Platform::XoChip) ? static_cast<Platform>(entry.platform) : Platform::Chip8;
+        rom.quirks = entry.quirks;
+        rom.data = entry.rom_offset ? file.data() + entry.rom_offset : nullptr;
+        return true;
+    }
+
+    // Get a ROM's bytes, from the library when it's packed and from the ROM's file otherwise
+    // Returns false if the ROM can't be read or no longer matches its hash
+    bool read(size_t idx, std::vector<byte> &program) const
+    {
+        Rom rom;
+        if (!get(idx, rom))
+            return false;
+
+        std::vector<byte> bytes;
+        if (rom.data)
+            bytes.assign(rom.data, rom.data + rom.size);
+        else if (!read_file(std::string(rom.path), bytes))
+            return false;
+
+        Sha256 sha;
+        sha.update(bytes.data(), bytes.size());
+        if (sha.finish() != rom.hash)
+            return false;
+
+        program = std::move(bytes);
+        return true;
+    }
+
+    // Guess what a ROM was written for from the instructions in it
+    // Data can't be told apart from code without running the ROM, so every aligned word is treated as an instruction
+    static void detect(const byte *rom, size_t size, Platform &platform, uint8_t &quirks)
+    {
+        bool super_chip = false;
+        bool xo_chip = size > 0x1000 - 0x200;
+        quirks = 0;
+
+        for (size_t idx = 0; idx + 1 < size; idx += 2)
+        {
+            const uint16_t instruction = rom[idx] << 8 | rom[idx + 1];
+            const uint8_t nibble = instruction >> 12;
+            const uint8_t low = instruction & 0xFF;
+
+            if (nibble == 0x8 && ((instruction & 0xF) == 0x6 || (instruction & 0xF) == 0xE))
+                quirks |= Quirk::SHIFT;
+            else if (nibble == 0x8 && (instruction & 0xF) >= 0x1 && (instruction & 0xF) <= 0x3)
+                quirks |= Quirk::LOGIC;
+            else if (nibble == 0xF && (low == 0x55 || low == 0x65))
+                quirks |= Quirk::LOAD_STORE;
+            else if (nibble == 0xB)
+                quirks |= Quirk::JUMP;
+
+            // Scrolling, hires, 16x16 sprites, big font and flag registers
+            if ((instruction & 0xFFF0) == 0x00C0 || (instruction >= 0x00FB && instruction <= 0x00FF) || (nibble == 0xD && (instruction & 0xF) == 0) ||
+                (nibble == 0xF && (low == 0x30 || low == 0x75 || low == 0x85)))
+                super_chip = true;
+
+            // Register ranges, long loads, bit planes and audio
+            if ((nibble == 0x5 && ((instruction & 0xF) == 0x2 || (instruction & 0xF) == 0x3)) || instruction == 0xF000 || instruction == 0xF002 ||
+                (nibble == 0xF && (low == 0x01 || low == 0x3A)))
+                xo_chip = true;
+        }
+
+        platform = xo_chip ? Platform::XoChip : super_chip ? Platform::SuperChip : Platform::Chip8;
+    }
+
+    // Scan directories for .ch8 files and write a library of them to path
+    // Returns the number of ROMs in the library, or -1 with error set if it couldn't be written
+    static long build(const std::vector<std::string> &directories, const std::string &path, bool pack, std::string &error)
+    {
+        struct Found
+        {
+            std::string name;
+            std::string path;
+            std::vector<byte> rom;
+        };
+
+        std::vector<Found> found;
+        for (const std::string &directory : directories)
+        {
+            std::error_code code;
+            for (std::filesystem::recursive_directory_iterator it(directory, code), end; it != end && !code; it.increment(code))
+            {
+                std::string extension = it->path().extension().string();
+                std::transform(extension.begin(), extension.end(), extension.begin(), [](char c)
+                               { return std::tolower(static_cast<unsigned char>(c)); });
+                if (!it->is_regular_file() || extension != ".ch8")
+                    continue;
+
+                Found rom{it->path().filename().string(), std::filesystem::absolute(it->path()).string(), {}};
+                if (read_file(rom.path, rom.rom) && !rom.rom.empty())
+                    found.push_back(std::move(rom));
+            }
+            if (code)
+            {
+                error = directory + ": " + code.message();
+                return -1;
+            }
+        }
+
+        // Sorted by name so ROMs are listed in a sensible order and rebuilding gives the same file
+        std::sort(found.begin(), found.end(), [](const Found &a, const Found &b)
+                  { return a.name != b.name ? a.name < b.name : a.path < b.path; });
+
+        std::vector<byte> out(sizeof(Header) + found.size() * sizeof(Entry));
+        const auto append = [&](const void *data, size_t size) -> uint32_t
+        {
+            const size_t offset = out.size();
+            out.insert(out.end(), static_cast<const byte *>(data), static_cast<const byte *>(data) + size);
+            return offset;
+        };
+
+        for (size_t idx = 0; idx < found.size(); idx++)
+        {
+            const Found &rom = found[idx];
+
+            Entry entry{};
+            entry.name_offset = append(rom.name.data(), rom.name.size());
+            entry.name_length = rom.name.size();
+            entry.path_offset = append(rom.path.data(), rom.path.size());
+            entry.path_length = rom.path.size();
+            entry.rom_offset = pack ? append(rom.rom.data(), rom.rom.size()) : 0;
+            entry.rom_size = rom.rom.size();
+
+            Sha256 sha;
+            sha.update(rom.rom.data(), rom.rom.size());
+            entry.hash = sha.finish();
+
+            Platform platform;
+            detect(rom.rom.data(), rom.rom.size(), platform, entry.quirks);
+            entry.platform = static_cast<uint8_t>(platform);
+
+            std::memcpy(out.data() + sizeof(Header) + idx * sizeof(Entry), &entry, sizeof(entry));
+        }
+
+        if (out.size() > UINT32_MAX)
+        {
+            error = "Library is too big";
+            return -1;
+        }
+
+        const Header header{MAGIC, VERSION, static_cast<uint32_t>(found.size()), 0};
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (!write_file_atomically(path, out.data(), out.size()))
+        {
+            error = "Couldn't write " + path;
+            return -1;
+        }
+        return found.size();
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// SHA-256, used to name cached ROMs by their contents
+class Sha256
+{
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+private:
+    static constexpr const std::array<uint32_t, 64> K{
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5, 0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74,
+        0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA, 0x983E5152, 0xA831C66D,
+        0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967, 0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E,
+        0x92722C85, 0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070, 0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+        0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+    std::array<uint32_t, 8> state{0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+    std::array<uint8_t, 64> block{};
+    size_t block_size = 0;
+    uint64_t length = 0;
+
+    [[nodiscard]] static inline uint32_t rotate(uint32_t value, int bits)
+    {
+        return (value >> bits) | (value << (32 - bits));
+    }
+
+    void compress()
+    {
+        std::array<uint32_t, 64> w;
+        for (size_t idx = 0; idx < 16; idx++)
+            w[idx] = static_cast<uint32_t>(block[idx * 4]) << 24 | block[idx * 4 + 1] << 16 | block[idx * 4 + 2] << 8 | block[idx * 4 + 3];
+        for (size_t idx = 16; idx < 64; idx++)
+        {
+            const uint32_t s0 = rotate(w[idx - 15], 7) ^ rotate(w[idx - 15], 18) ^ (w[idx - 15] >> 3);
+            const uint32_t s1 = rotate(w[idx - 2], 17) ^ rotate(w[idx - 2], 19) ^ (w[idx - 2] >> 10);
+            w[idx] = w[idx - 16] + s0 + w[idx - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t idx = 0; idx < 64; idx++)
+        {
+            const uint32_t t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + K[idx] + w[idx];
+            const uint32_t t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+public:
+    void update(const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        length += size;
+        while (size > 0)
+        {
+            const size_t taken = std::min(size, block.size() - block_size);
+            std::memcpy(block.data() + block_size, bytes, taken);
+            block_size += taken;
+            bytes += taken;
+            size -= taken;
+
+            if (block_size == block.size())
+            {
+                compress();
+                block_size = 0;
+            }
+        }
+    }
+
+    // Finish the hash, the Sha256 can't be updated afterwards
+    [[nodiscard]] Digest finish()
+    {
+        const uint64_t bits = length * 8;
+        const uint8_t padding = 0x80;
+        update(&padding, 1);
+        const uint8_t zero = 0;
+        while (block_size != 56)
+            update(&zero, 1);
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            const uint8_t part = bits >> shift;
+            update(&part, 1);
+        }
+
+        Digest digest;
+        for (size_t idx = 0; idx < digest.size(); idx++)
+            digest[idx] = state[idx / 4] >> (24 - idx % 4 * 8);
+        return digest;
+    }
+
+    // The hash of data as lowercase hex
+    [[nodiscard]] static std::string hex(const void *data, size_t size)
+    {
+        Sha256 sha;
+        sha.update(data, size);
+        const Digest digest = sha.finish();
+
+        static constexpr const char DIGITS[] = "0123456789abcdef";
+        std::string hex;
+        for (uint8_t part : digest)
+        {
+            hex += DIGITS[part >> 4];
+            hex += DIGITS[part & 0xF];
+        }
+        return hex;
+    }
+
+    [[nodiscard]] static std::string hex(const std::string &data)
+    {
+        return hex(data.data(), data.size());
+    }
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed size pool of threads where each thread has its own queue of tasks
+// Threads work through their own queue from the back and steal from the front of other queues when theirs is empty
+class ThreadPool
+{
+private:
+    struct Queue
+    {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    // The queue the next submitted task goes to
+    std::atomic<size_t> next_queue{0};
+
+    // The number of tasks that were submitted but haven't finished yet
+    std::atomic<size_t> pending{0};
+
+    // These are used to put threads to sleep while there is no work and to wait for all tasks to finish
+    std::mutex idle_mtx;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    bool stopping = false;
+
+    bool pop_own(size_t idx, std::function<void()> &task)
+    {
+        Queue &queue = *queues[idx];
+        std::unique_lock<std::mutex> lock(queue.mtx);
+        if (queue.tasks.empty())
+            return false;
+
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t idx, std::function<void()> &task)
+    {
+        for (size_t offset = 1; offset < queues.size(); offset++)
+        {
+            Queue &queue = *queues[(idx + offset) % queues.size()];
+            std::unique_lock<std::mutex> lock(queue.mtx);
+            if (queue.tasks.empty())
+                continue;
+
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+
+        return false;
+    }
+
+    void worker(size_t idx)
+    {
+        std::function<void()> task;
+        while (true)
+        {
+            if (pop_own(idx, task) || steal(idx, task))
+            {
+                task();
+                task = nullptr;
+
+                if (--pending == 0)
+                {
+                    std::unique_lock<std::mutex> lock(idle_mtx);
+                    done_cv.notify_all();
+                }
+                continue;
+            }
+
+            // Nothing to do, sleep until more work shows up
+            std::unique_lock<std::mutex> lock(idle_mtx);
+            if (stopping)
+                return;
+            work_cv.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+
+public:
+    ThreadPool(size_t thread_count = std::thread::hardware_concurrency())
+    {
+        thread_count = std::max<size_t>(thread_count, 1);
+
+        for (size_t idx = 0; idx < thread_count; idx++)
+            queues.push_back(std::make_unique<Queue>());
+
+        for (size_t idx = 0; idx < thread_count; idx++)
+            threads.emplace_back(&ThreadPool::worker, this, idx);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(idle_mtx);
+            stopping = true;
+            work_cv.notify_all();
+        }
+
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return threads.size();
+    }
+
+    void submit(std::function<void()> task)
+    {
+        pending++;
+
+        Queue &queue = *queues[next_queue++ % queues.size()];
+        {
+            std::unique_lock<std::mutex> lock(queue.mtx);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        std::unique_lock<std::mutex> lock(idle_mtx);
+        work_cv.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(idle_mtx);
+        done_cv.wait(lock, [this]
+                     { return pending == 0; });
+    }
+};
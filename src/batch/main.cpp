@@ -0,0 +1,378 @@
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+
+#include "../core/Chip8.hpp"
+#include "../core/Movie.hpp"
+#include "../core/SaveState.hpp"
+#include "../core/Scheduler.hpp"
+#include "../files.hpp"
+#include "../Prefetcher.hpp"
+#include "../Programs.hpp"
+#include "../RomLibrary.hpp"
+#include "./ThreadPool.hpp"
+
+// Runs ROMs headless and in parallel, printing a line of results for each one
+// Usage: chip8_batch [--cycles N] [--ips N] [--seed N] [--engine interpreter|threaded|jit|recompiled] [--threads N] [--movie movie.c8m]
+//                    [--state warm.c8s [--forks N]] [--save-state out.c8s] [--cache DIR] [--mirror DIR] [--revalidate] [--connections N] [--list prog_list.txt]
+//                    [--library library.c8lib] [rom.ch8...]
+// Timers tick once every frame's worth of instructions at the given instructions per second
+// ROMs from a list are all downloaded into the ROM cache up front, with up to --connections downloads at once
+// The mirror stands in for the remote host
+// With a movie, its seed, instructions per second, length and key presses are used, and runs that don't end on the same display are a "desync"
+// ROMs that run into an invalid instruction, including 0nnn, stop there and are "invalid", with the address on stderr
+// Runs that would need the JIT on a host without it, or the recompiled engine for a ROM that wasn't recompiled, aren't run and are "no-engine"
+// With a save state, every ROM starts from it instead of from the start, and with --forks it's run that many times on its own, each fork seeded with the seed plus its number
+// A batch of a single run can save the state it ends in, which is how a warm state to fork from is made
+
+struct Result
+{
+    std::string name;
+    std::string status;
+    uint64_t framebuffer_hash = 0;
+    uint64_t instructions = 0;
+    double seconds = 0;
+};
+
+// Run frames back to back, ticking the timers in between them like the scheduler does
+// Without a movie nothing will ever press a key, so stop once the program is waiting for one
+static void run_frames(Chip8 &chip8, const KeypadState &keypad, MoviePlayer *player, uint64_t cycles, uint32_t instructions_per_second, const char *save_path,
+                       Result &result)
+{
+    Scheduler scheduler;
+    scheduler.set_instructions_per_second(instructions_per_second);
+    result.status = "ok";
+    const auto start = std::chrono::steady_clock::now();
+    while (result.instructions < cycles)
+    {
+        const uint32_t count = std::min<uint64_t>(scheduler.next_frame_instructions(), cycles - result.instructions);
+        result.instructions += player ? player->run(chip8, count) : chip8.run(count);
+        chip8.tick_timers();
+
+        // The ROM ran into something that isn't an instruction, the rest of the batch carries on without it
+        if (chip8.halted())
+        {
+            const addr_t pc = chip8.get_registers()->pc_reg;
+            const std::array<byte, 0x1000> &memory = *chip8.get_memory();
+            result.status = "invalid";
+            fprintf(stderr, "%s: invalid instruction %02X%02X at %03X\n", result.name.c_str(), memory[pc], memory[(pc + 1) & 0xFFF], pc);
+            break;
+        }
+
+        // Frames pass instantly while waiting for a key, but with no input coming the wait would never end
+        if (chip8.waiting_for_key() && !keypad.next_event_cycle() && (!player || player->finished()))
+        {
+            result.status = "key-wait";
+            break;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.framebuffer_hash = chip8.get_framebuffer().hash();
+
+    if (save_path)
+    {
+        SaveState state;
+        chip8.save_state(state);
+        if (!write_save_state(save_path, state))
+            fprintf(stderr, "%s: couldn't write save state %s\n", result.name.c_str(), save_path);
+    }
+}
+
+static void run_rom(Program &program, bool local, const RomCache &cache, uint64_t cycles, uint32_t instructions_per_second, uint64_t seed, Engine engine, const Movie *movie,
+                    const SaveState *state, const char *save_path, Result &result)
+{
+    result.name = program.name;
+
+    // Programs from a library were read when it was opened
+    if (local && program.program.empty())
+    {
+        if (!read_file(program.path, program.program))
+        {
+            result.status = "unreadable";
+            return;
+        }
+    }
+    else if (!program.get_program(cache))
+    {
+        result.status = "unavailable";
+        fprintf(stderr, "%s: %s\n", program.name.c_str(), program.error.c_str());
+        return;
+    }
+
+    if (program.program.empty())
+    {
+        result.status = "empty";
+        return;
+    }
+
+    if (movie)
+    {
+        if (Movie::hash_rom(program.program) != movie->rom_hash)
+        {
+            result.status = "wrong-rom";
+            return;
+        }
+        cycles = movie->cycles;
+        instructions_per_second = movie->instructions_per_second;
+        seed = movie->seed;
+    }
+
+    const std::shared_ptr<KeypadState> keypad = std::make_shared<KeypadState>();
+    Chip8 chip8(keypad);
+    chip8.seed(seed);
+    chip8.load_program(program.program);
+    chip8.set_engine(engine);
+    if (!chip8.engine_available())
+    {
+        result.status = "no-engine";
+        fprintf(stderr, "%s: the engine asked for isn't available for it\n", program.name.c_str());
+        return;
+    }
+    if (state)
+        chip8.load_state(*state);
+    std::unique_ptr<MoviePlayer> player = movie ? std::make_unique<MoviePlayer>(*movie, keypad) : nullptr;
+
+    run_frames(chip8, *keypad, player.get(), cycles, instructions_per_second, save_path, result);
+    if (movie && result.framebuffer_hash != movie->framebuffer_hash)
+        result.status = "desync";
+}
+
+// Run a save state on its own, the fork number only changes the seed
+static void run_fork(const SaveState &state, size_t fork, uint64_t cycles, uint32_t instructions_per_second, uint64_t seed, Engine engine, const char *save_path,
+                     Result &result)
+{
+    result.name = "fork " + std::to_string(fork);
+
+    const std::shared_ptr<KeypadState> keypad = std::make_shared<KeypadState>();
+    Chip8 chip8(keypad);
+    chip8.set_engine(engine);
+    if (!chip8.engine_available())
+    {
+        result.status = "no-engine";
+        fprintf(stderr, "%s: the engine asked for isn't available for it\n", result.name.c_str());
+        return;
+    }
+    chip8.load_state(state);
+    chip8.seed(seed + fork);
+
+    run_frames(chip8, *keypad, nullptr, cycles, instructions_per_second, save_path, result);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t cycles = 1000000;
+    uint32_t instructions_per_second = Scheduler::DEFAULT_INSTRUCTIONS_PER_SECOND;
+    uint64_t seed = Random::DEFAULT_SEED;
+    std::unique_ptr<Movie> movie;
+    std::unique_ptr<SaveState> state;
+    size_t forks = 0;
+    const char *save_path = nullptr;
+    RomCache cache = RomCache::shared();
+    size_t connections = Prefetcher::DEFAULT_CONNECTIONS;
+    Engine engine = Engine::Interpreter;
+    size_t threads = std::thread::hardware_concurrency();
+    std::vector<Program> programs;
+    std::vector<bool> local;
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "--cycles") && idx + 1 < argc)
+        {
+            cycles = std::strtoull(argv[++idx], nullptr, 10);
+        }
+        else if (!strcmp(argv[idx], "--ips") && idx + 1 < argc)
+        {
+            instructions_per_second = std::strtoul(argv[++idx], nullptr, 10);
+        }
+        else if (!strcmp(argv[idx], "--seed") && idx + 1 < argc)
+        {
+            seed = std::strtoull(argv[++idx], nullptr, 0);
+        }
+        else if (!strcmp(argv[idx], "--movie") && idx + 1 < argc)
+        {
+            movie = std::make_unique<Movie>();
+            if (!read_movie(argv[++idx], *movie))
+            {
+                fprintf(stderr, "Couldn't read movie %s\n", argv[idx]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[idx], "--state") && idx + 1 < argc)
+        {
+            state = std::make_unique<SaveState>();
+            if (!read_save_state(argv[++idx], *state))
+            {
+                fprintf(stderr, "Couldn't read save state %s\n", argv[idx]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[idx], "--forks") && idx + 1 < argc)
+        {
+            forks = std::strtoul(argv[++idx], nullptr, 10);
+        }
+        else if (!strcmp(argv[idx], "--save-state") && idx + 1 < argc)
+        {
+            save_path = argv[++idx];
+        }
+        else if (!strcmp(argv[idx], "--cache") && idx + 1 < argc)
+        {
+            cache.set_directory(argv[++idx]);
+        }
+        else if (!strcmp(argv[idx], "--mirror") && idx + 1 < argc)
+        {
+            cache.set_mirror(argv[++idx]);
+        }
+        else if (!strcmp(argv[idx], "--revalidate"))
+        {
+            cache.set_revalidate(true);
+        }
+        else if (!strcmp(argv[idx], "--connections") && idx + 1 < argc)
+        {
+            connections = std::strtoul(argv[++idx], nullptr, 10);
+        }
+        else if (!strcmp(argv[idx], "--engine") && idx + 1 < argc)
+        {
+            idx++;
+            if (!strcmp(argv[idx], "interpreter"))
+                engine = Engine::Interpreter;
+            else if (!strcmp(argv[idx], "threaded"))
+                engine = Engine::Threaded;
+            else if (!strcmp(argv[idx], "jit"))
+                engine = Engine::Jit;
+            else if (!strcmp(argv[idx], "recompiled"))
+                engine = Engine::Recompiled;
+            else
+            {
+                fprintf(stderr, "Unknown engine %s\n", argv[idx]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[idx], "--threads") && idx + 1 < argc)
+        {
+            threads = std::strtoul(argv[++idx], nullptr, 10);
+        }
+        else if (!strcmp(argv[idx], "--list") && idx + 1 < argc)
+        {
+            Programs list(argv[++idx]);
+            for (Program &program : list.programs)
+            {
+                programs.push_back(program);
+                local.push_back(false);
+            }
+        }
+        else if (!strcmp(argv[idx], "--library") && idx + 1 < argc)
+        {
+            RomLibrary library;
+            if (!library.open(argv[++idx]))
+            {
+                fprintf(stderr, "%s isn't a ROM library\n", argv[idx]);
+                return 1;
+            }
+
+            // Library ROMs are read up front, which also checks they still match the library
+            for (size_t rom_idx = 0; rom_idx < library.size(); rom_idx++)
+            {
+                RomLibrary::Rom rom;
+                library.get(rom_idx, rom);
+                Program &program = programs.emplace_back(std::string(rom.name), std::string(rom.path));
+                local.push_back(true);
+                if (!library.read(rom_idx, program.program))
+                    fprintf(stderr, "%s: doesn't match the library\n", program.name.c_str());
+            }
+        }
+        else if (argv[idx][0] == '-')
+        {
+            fprintf(stderr, "Usage: %s [--cycles N] [--ips N] [--seed N] [--engine interpreter|threaded|jit|recompiled] [--threads N] [--movie movie.c8m] "
+                            "[--state warm.c8s [--forks N]] [--save-state out.c8s] [--cache DIR] [--mirror DIR] [--revalidate] [--connections N] [--list prog_list.txt] [--library library.c8lib] "
+                            "[rom.ch8...]\n",
+                    argv[0]);
+            return 1;
+        }
+        else
+        {
+            programs.emplace_back(argv[idx], argv[idx]);
+            local.push_back(true);
+        }
+    }
+
+    // Movies play back from power on, so they can't start from a state
+    if (state && movie)
+    {
+        fprintf(stderr, "--state and --movie can't be used together\n");
+        return 1;
+    }
+    if (forks && !state)
+    {
+        fprintf(stderr, "--forks needs a --state to fork\n");
+        return 1;
+    }
+
+    if (save_path && programs.size() + forks != 1)
+    {
+        fprintf(stderr, "--save-state needs exactly one run to save\n");
+        return 1;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Download everything at once instead of one at a time on each worker
+    std::vector<Program> remote;
+    for (size_t idx = 0; idx < programs.size(); idx++)
+    {
+        if (!local[idx])
+            remote.push_back(programs[idx]);
+    }
+    if (!remote.empty())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        Prefetcher prefetcher(cache, remote, connections);
+        prefetcher.wait();
+        fprintf(stderr, "Cached %zu ROMs in %.3fs, %zu failed\n", prefetcher.get_total(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                prefetcher.get_failed());
+
+        // Everything was just revalidated, so the workers can trust the cache
+        cache.set_revalidate(false);
+    }
+
+    std::vector<Result> results(programs.size() + forks);
+    std::mutex output_mtx;
+    const auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads);
+        for (size_t idx = 0; idx < results.size(); idx++)
+        {
+            pool.submit([&, idx]
+                        {
+                            Result &result = results[idx];
+                            if (idx < programs.size())
+                                run_rom(programs[idx], local[idx], cache, cycles, instructions_per_second, seed, engine, movie.get(), state.get(), save_path, result);
+                            else
+                                run_fork(*state, idx - programs.size(), cycles, instructions_per_second, seed, engine, save_path, result);
+
+                            std::unique_lock<std::mutex> lock(output_mtx);
+                            printf("%s\t%s\t%016" PRIx64 "\t%" PRIu64 "\t%.0f\n", result.name.c_str(), result.status.c_str(), result.framebuffer_hash,
+                                   result.instructions, result.seconds > 0 ? result.instructions / result.seconds : 0.0);
+                            fflush(stdout);
+                        });
+        }
+        pool.wait();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total_instructions = 0;
+    for (const Result &result : results)
+        total_instructions += result.instructions;
+    fprintf(stderr, "%zu runs, %" PRIu64 " instructions in %.3fs (%.0f instructions per second)\n", results.size(), total_instructions, seconds, total_instructions / seconds);
+
+    curl_global_cleanup();
+
+    return 0;
+}
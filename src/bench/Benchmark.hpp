@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Stop the compiler from optimizing away a value a benchmark computes
+template <typename Type>
+static inline void keep(const Type &value)
+{
+    asm volatile(""
+                 :
+                 : "g"(&value)
+                 : "memory");
+}
+
+// Times pieces of code the same way every time, so results can be compared between commits
+// Each benchmark is run a few times to warm up, then timed over a number of repetitions
+// A repetition runs the code a fixed number of times, and the time per run is reported as the median and 99th percentile over the repetitions
+class Benchmark
+{
+public:
+    static constexpr const size_t DEFAULT_WARMUP = 10;
+    static constexpr const size_t DEFAULT_REPETITIONS = 200;
+
+    struct Result
+    {
+        std::string name;
+        uint64_t iterations;
+        size_t repetitions;
+        double median_ns;
+        double p99_ns;
+        double min_ns;
+    };
+
+private:
+    size_t warmup = DEFAULT_WARMUP;
+    size_t repetitions = DEFAULT_REPETITIONS;
+    std::string filter;
+    std::vector<Result> results;
+
+public:
+    void set_warmup(size_t warmup)
+    {
+        this->warmup = warmup;
+    }
+
+    void set_repetitions(size_t repetitions)
+    {
+        this->repetitions = std::max<size_t>(repetitions, 1);
+    }
+
+    // Only benchmarks with this in their name are run
+    void set_filter(std::string filter)
+    {
+        this->filter = std::move(filter);
+    }
+
+    // Time function(iterations), which has to run what's being measured iterations times
+    template <typename Function>
+    void run(const std::string &name, uint64_t iterations, Function &&function)
+    {
+        if (name.find(filter) == std::string::npos)
+            return;
+
+        for (size_t idx = 0; idx < warmup; idx++)
+            function(iterations);
+
+        std::vector<double> times(repetitions);
+        for (double &time : times)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            function(iterations);
+            time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+        }
+
+        std::sort(times.begin(), times.end());
+        results.push_back({name, iterations, repetitions, times[times.size() / 2], times[std::min(times.size() - 1, times.size() * 99 / 100)], times.front()});
+
+        const Result &result = results.back();
+        fprintf(stderr, "%-32s %10.2f ns median %10.2f ns p99\n", result.name.c_str(), result.median_ns, result.p99_ns);
+    }
+
+    [[nodiscard]] const std::vector<Result> &get_results() const
+    {
+        return results;
+    }
+
+    // Names are only ever letters, digits and punctuation that doesn't need escaping
+    void write_json(FILE *file) const
+    {
+        fprintf(file, "{\n  \"warmup\": %zu,\n  \"repetitions\": %zu,\n  \"benchmarks\": [\n", warmup, repetitions);
+        for (size_t idx = 0; idx < results.size(); idx++)
+        {
+            const Result &result = results[idx];
+            fprintf(file, "    {\"name\": \"%s\", \"iterations\": %llu, \"median_ns\": %.3f, \"p99_ns\": %.3f, \"min_ns\": %.3f}%s\n", result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations), result.median_ns, result.p99_ns, result.min_ns, idx + 1 < results.size() ? "," : "");
+        }
+        fprintf(file, "  ]\n}\n");
+    }
+};
@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+#include <sys/resource.h>
+
+#include "../core/Chip8.hpp"
+#include "../core/Movie.hpp"
+#include "../core/Random.hpp"
+#include "../core/Scheduler.hpp"
+#include "../files.hpp"
+#include "../Programs.hpp"
+#include "../RomLibrary.hpp"
+
+// Runs every ROM of a corpus headless, one at a time, for a fixed number of instructions with scripted key presses
+// For each ROM it prints the instructions per second, the peak resident memory and the allocations per million instructions
+// Usage: chip8_corpus_bench [--cycles N] [--ips N] [--seed N] [--engine interpreter|threaded|jit|recompiled] [--repetitions N]
+//                           [--cache DIR] [--mirror DIR] [--list prog_list.txt] [--library library.c8lib]
+//                           [--baseline baseline.tsv] [--threshold PERCENT] [--write-baseline baseline.tsv] [rom.ch8...]
+// ROMs that run into an invalid instruction, including 0nnn, stop there and are reported as "invalid" instead of being timed
+// ROMs the engine isn't available for, like ones that weren't recompiled, are reported as "no-engine" instead of timing the interpreter in its place
+// With a baseline, ROMs that got slower, or use more memory or allocations, by more than the threshold are listed and the exit status is 2
+// Build it with -DCMAKE_BUILD_TYPE=Release, numbers from an unoptimized build say little about the real thing
+
+// Every allocation the program makes, the replacements below count them
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+struct Settings
+{
+    uint64_t cycles = 2000000;
+    uint32_t instructions_per_second = Scheduler::DEFAULT_INSTRUCTIONS_PER_SECOND;
+    uint64_t seed = Random::DEFAULT_SEED;
+    std::string engine = "interpreter";
+
+    [[nodiscard]] bool operator==(const Settings &other) const
+    {
+        return cycles == other.cycles && instructions_per_second == other.instructions_per_second && seed == other.seed && engine == other.engine;
+    }
+};
+
+struct Result
+{
+    std::string name;
+    std::string status;
+    double instructions_per_second = 0;
+    uint64_t peak_rss_kb = 0;
+    double allocations_per_million = 0;
+};
+
+// Resetting the peak only works on Linux, anywhere else the peak is the whole process's so far
+static void reset_peak_rss()
+{
+    if (FILE *file = fopen("/proc/self/clear_refs", "w"))
+    {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+static uint64_t peak_rss_kb()
+{
+    uint64_t peak = 0;
+    if (FILE *file = fopen("/proc/self/status", "r"))
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), file))
+        {
+            if (sscanf(line, "VmHWM: %" SCNu64, &peak) == 1)
+                break;
+        }
+        fclose(file);
+    }
+    if (peak == 0)
+    {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            peak = usage.ru_maxrss;
+    }
+    return peak;
+}
+
+// Half a second after every press a random key goes down for a tenth of a second, enough to get most games past their title screens
+// The script only depends on the seed, so every ROM and every run gets the same one
+static Movie script_input(const Settings &settings)
+{
+    Movie movie;
+    Random random(settings.seed);
+    const uint64_t interval = std::max<uint64_t>(settings.instructions_per_second / 2, 1);
+    const uint64_t held = std::max<uint64_t>(settings.instructions_per_second / 10, 1);
+    for (uint64_t cycle = interval; cycle + held < settings.cycles; cycle += interval + held)
+    {
+        const uint8_t key = random.next_byte() & 0xF;
+        movie.events.push_back({cycle, key, true});
+        movie.events.push_back({cycle + held, key, false});
+    }
+    return movie;
+}
+
+// Run frames back to back like chip8_batch, returns the instructions executed
+// Allocations are only counted while running, not while setting up the Chip 8
+// Returns false if the ROM stopped at an invalid instruction before running all of them
+static bool run_once(const Program &program, const Settings &settings, Engine engine, const Movie &script, uint64_t &instructions, uint64_t &allocated)
+{
+    const std::shared_ptr<KeypadState> keypad = std::make_shared<KeypadState>();
+    Chip8 chip8(keypad);
+    chip8.seed(settings.seed);
+    chip8.load_program(program.program);
+    chip8.set_engine(engine);
+    MoviePlayer player(script, keypad);
+
+    Scheduler scheduler;
+    scheduler.set_instructions_per_second(settings.instructions_per_second);
+    instructions = 0;
+    const uint64_t allocations_before = allocations.load(std::memory_order_relaxed);
+    while (instructions < settings.cycles)
+    {
+        const uint32_t count = std::min<uint64_t>(scheduler.next_frame_instructions(), settings.cycles - instructions);
+        instructions += player.run(chip8, count);
+        chip8.tick_timers();
+        if (chip8.halted())
+            break;
+    }
+    allocated = allocations.load(std::memory_order_relaxed) - allocations_before;
+
+    if (!chip8.halted())
+        return true;
+
+    const addr_t pc = chip8.get_registers()->pc_reg;
+    const std::array<byte, 0x1000> &memory = *chip8.get_memory();
+    fprintf(stderr, "%s: invalid instruction %02X%02X at %03X after %" PRIu64 " instructions\n", program.name.c_str(), memory[pc], memory[(pc + 1) & 0xFFF], pc, instructions);
+    return false;
+}
+
+static void run_rom(Program &program, bool local, const RomCache &cache, const Settings &settings, Engine engine, const Movie &script, size_t repetitions, Result &result)
+{
+    result.name = program.name;
+
+    if (local && program.program.empty())
+    {
+        if (!read_file(program.path, program.program))
+        {
+            result.status = "unreadable";
+            return;
+        }
+    }
+    else if (!program.get_program(cache))
+    {
+        result.status = "unavailable";
+        fprintf(stderr, "%s: %s\n", program.name.c_str(), program.error.c_str());
+        return;
+    }
+
+    if (program.program.empty())
+    {
+        result.status = "empty";
+        return;
+    }
+
+    // The interpreter quietly stands in for an engine that isn't there, which would time the wrong thing
+    {
+        Chip8 chip8(std::make_shared<KeypadState>());
+        chip8.load_program(program.program);
+        chip8.set_engine(engine);
+        if (!chip8.engine_available())
+        {
+            result.status = "no-engine";
+            fprintf(stderr, "%s: the engine asked for isn't available for it\n", program.name.c_str());
+            return;
+        }
+    }
+
+    // Memory and allocations come from the first run, the speed is the fastest of them all since noise only ever slows a run down
+    double fastest = 0;
+    for (size_t idx = 0; idx < repetitions; idx++)
+    {
+        if (idx == 0)
+            reset_peak_rss();
+
+        uint64_t instructions = 0;
+        uint64_t allocated = 0;
+        const auto start = std::chrono::steady_clock::now();
+        const bool completed = run_once(program, settings, engine, script, instructions, allocated);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // Halting is deterministic, so there's no point timing it again, and a few instructions say nothing about speed
+        if (!completed)
+        {
+            result.status = "invalid";
+            return;
+        }
+
+        if (seconds > 0)
+            fastest = std::max(fastest, instructions / seconds);
+
+        if (idx == 0)
+        {
+            result.peak_rss_kb = peak_rss_kb();
+            result.allocations_per_million = instructions ? allocated * 1e6 / instructions : 0;
+        }
+    }
+
+    result.instructions_per_second = fastest;
+    result.status = "ok";
+}
+
+// A baseline is the settings it was made with followed by a line for each ROM that ran on the engine it names
+// # cycles N ips N seed N engine NAME
+// name<TAB>instructions per second<TAB>peak RSS in kB<TAB>allocations per million instructions
+static bool write_baseline(const char *path, const Settings &settings, const std::vector<Result> &results)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    fprintf(file, "# cycles %" PRIu64 " ips %" PRIu32 " seed %" PRIu64 " engine %s\n", settings.cycles, settings.instructions_per_second, settings.seed, settings.engine.c_str());
+    for (const Result &result : results)
+    {
+        // Anything else, no-engine included, wasn't measured on the baseline's engine
+        if (result.status == "ok")
+            fprintf(file, "%s\t%.0f\t%" PRIu64 "\t%.3f\n", result.name.c_str(), result.instructions_per_second, result.peak_rss_kb, result.allocations_per_million);
+    }
+    return fclose(file) == 0;
+}
+
+static bool read_baseline(const char *path, Settings &settings, std::map<std::string, Result> &results)
+{
+    std::vector<byte> contents;
+    if (!read_file(path, contents))
+        return false;
+
+    const std::string text(contents.begin(), contents.end());
+    size_t start = 0;
+    bool has_settings = false;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+        const std::string line = text.substr(start, end - start);
+        start = end + 1;
+
+        if (line.empty())
+            continue;
+
+        if (line[0] == '#')
+        {
+            char engine[32];
+            has_settings = sscanf(line.c_str(), "# cycles %" SCNu64 " ips %" SCNu32 " seed %" SCNu64 " engine %31s", &settings.cycles, &settings.instructions_per_second,
+                                  &settings.seed, engine) == 4;
+            if (!has_settings)
+                return false;
+            settings.engine = engine;
+            continue;
+        }
+
+        const size_t separator = line.find('\t');
+        if (separator == std::string::npos)
+            return false;
+        Result result;
+        result.name = line.substr(0, separator);
+        result.status = "ok";
+        if (sscanf(line.c_str() + separator + 1, "%lf\t%" SCNu64 "\t%lf", &result.instructions_per_second, &result.peak_rss_kb, &result.allocations_per_million) != 3)
+            return false;
+        results[result.name] = result;
+    }
+    return has_settings;
+}
+
+// Prints every regression, and returns how many ROMs regressed
+static size_t compare(const std::vector<Result> &results, const std::map<std::string, Result> &baseline, double threshold)
+{
+    size_t regressed = 0;
+    size_t compared = 0;
+    size_t skipped = 0;
+    for (const Result &result : results)
+    {
+        const auto found = baseline.find(result.name);
+        if (found == baseline.end())
+            continue;
+        const Result &before = found->second;
+
+        // Nothing was measured to compare, like for a ROM that isn't recompiled in this build, which says nothing about the code being slower
+        if (result.status == "no-engine")
+        {
+            fprintf(stderr, "SKIPPED %s: %s\n", result.name.c_str(), result.status.c_str());
+            skipped++;
+            continue;
+        }
+
+        if (result.status != "ok")
+        {
+            fprintf(stderr, "REGRESSION %s: %s\n", result.name.c_str(), result.status.c_str());
+            regressed++;
+            continue;
+        }
+        compared++;
+
+        bool worse = false;
+        if (result.instructions_per_second < before.instructions_per_second * (1 - threshold))
+        {
+            fprintf(stderr, "REGRESSION %s: %.0f instructions per second, was %.0f (%+.1f%%)\n", result.name.c_str(), result.instructions_per_second,
+                    before.instructions_per_second, (result.instructions_per_second / before.instructions_per_second - 1) * 100);
+            worse = true;
+        }
+        if (result.peak_rss_kb > before.peak_rss_kb * (1 + threshold))
+        {
+            fprintf(stderr, "REGRESSION %s: %" PRIu64 " kB peak RSS, was %" PRIu64 " kB\n", result.name.c_str(), result.peak_rss_kb, before.peak_rss_kb);
+            worse = true;
+        }
+        // Allocations don't depend on timing, so with none before any at all is a regression
+        if (result.allocations_per_million > before.allocations_per_million * (1 + threshold))
+        {
+            fprintf(stderr, "REGRESSION %s: %.3f allocations per million instructions, was %.3f\n", result.name.c_str(), result.allocations_per_million,
+                    before.allocations_per_million);
+            worse = true;
+        }
+        regressed += worse;
+    }
+
+    fprintf(stderr, "Compared %zu ROMs against the baseline, %zu regressed by more than %.1f%%, %zu skipped\n", compared, regressed, threshold * 100, skipped);
+    return regressed;
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    Engine engine = Engine::Interpreter;
+    size_t repetitions = 5;
+    RomCache cache = RomCache::shared();
+    const char *baseline_path = nullptr;
+    const char *write_path = nullptr;
+    double threshold = 0.1;
+    std::vector<Program> programs;
+    std::vector<bool> local;
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "--cycles") && idx + 1 < argc)
+        {
+            settings.cycles = std::strtoull(argv[++idx], nullptr, 10);
+        }
+        else if (!strcmp(argv[idx], "--ips") && idx + 1 < argc)
+        {
+            settings.instructions_per_second = std::strtoul(argv[++idx], nullptr, 10);
+        }
+        else if (!strcmp(argv[idx], "--seed") && idx + 1 < argc)
+        {
+            settings.seed = std::strtoull(argv[++idx], nullptr, 0);
+        }
+        else if (!strcmp(argv[idx], "--engine") && idx + 1 < argc)
+        {
+            idx++;
+            if (!strcmp(argv[idx], "interpreter"))
+                engine = Engine::Interpreter;
+            else if (!strcmp(argv[idx], "threaded"))
+                engine = Engine::Threaded;
+            else if (!strcmp(argv[idx], "jit"))
+                engine = Engine::Jit;
+            else if (!strcmp(argv[idx], "recompiled"))
+                engine = Engine::Recompiled;
+            else
+            {
+                fprintf(stderr, "Unknown engine %s\n", argv[idx]);
+                return 1;
+            }
+            settings.engine = argv[idx];
+        }
+        else if (!strcmp(argv[idx], "--repetitions") && idx + 1 < argc)
+        {
+            repetitions = std::max<size_t>(std::strtoul(argv[++idx], nullptr, 10), 1);
+        }
+        else if (!strcmp(argv[idx], "--cache") && idx + 1 < argc)
+        {
+            cache.set_directory(argv[++idx]);
+        }
+        else if (!strcmp(argv[idx], "--mirror") && idx + 1 < argc)
+        {
+            cache.set_mirror(argv[++idx]);
+        }
+        else if (!strcmp(argv[idx], "--baseline") && idx + 1 < argc)
+        {
+            baseline_path = argv[++idx];
+        }
+        else if (!strcmp(argv[idx], "--threshold") && idx + 1 < argc)
+        {
+            threshold = std::strtod(argv[++idx], nullptr) / 100;
+        }
+        else if (!strcmp(argv[idx], "--write-baseline") && idx + 1 < argc)
+        {
+            write_path = argv[++idx];
+        }
+        else if (!strcmp(argv[idx], "--list") && idx + 1 < argc)
+        {
+            Programs list(argv[++idx]);
+            for (Program &program : list.programs)
+            {
+                programs.push_back(program);
+                local.push_back(false);
+            }
+        }
+        else if (!strcmp(argv[idx], "--library") && idx + 1 < argc)
+        {
+            RomLibrary library;
+            if (!library.open(argv[++idx]))
+            {
+                fprintf(stderr, "%s isn't a ROM library\n", argv[idx]);
+                return 1;
+            }
+
+            for (size_t rom_idx = 0; rom_idx < library.size(); rom_idx++)
+            {
+                RomLibrary::Rom rom;
+                library.get(rom_idx, rom);
+                Program &program = programs.emplace_back(std::string(rom.name), std::string(rom.path));
+                local.push_back(true);
+                if (!library.read(rom_idx, program.program))
+                    fprintf(stderr, "%s: doesn't match the library\n", program.name.c_str());
+            }
+        }
+        else if (argv[idx][0] == '-')
+        {
+            fprintf(stderr, "Usage: %s [--cycles N] [--ips N] [--seed N] [--engine interpreter|threaded|jit|recompiled] [--repetitions N] [--cache DIR] [--mirror DIR] "
+                            "[--list prog_list.txt] [--library library.c8lib] [--baseline baseline.tsv] [--threshold PERCENT] [--write-baseline baseline.tsv] [rom.ch8...]\n",
+                    argv[0]);
+            return 1;
+        }
+        else
+        {
+            programs.emplace_back(argv[idx], argv[idx]);
+            local.push_back(true);
+        }
+    }
+
+    // Read the baseline first, there's no point running everything if it can't be compared against
+    Settings baseline_settings;
+    std::map<std::string, Result> baseline;
+    if (baseline_path)
+    {
+        if (!read_baseline(baseline_path, baseline_settings, baseline))
+        {
+            fprintf(stderr, "Couldn't read baseline %s\n", baseline_path);
+            return 1;
+        }
+        if (!(baseline_settings == settings))
+        {
+            fprintf(stderr, "%s was made with --cycles %" PRIu64 " --ips %" PRIu32 " --seed %" PRIu64 " --engine %s, run with the same settings to compare against it\n",
+                    baseline_path, baseline_settings.cycles, baseline_settings.instructions_per_second, baseline_settings.seed, baseline_settings.engine.c_str());
+            return 1;
+        }
+    }
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: built without optimizations\n");
+#endif
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // One ROM at a time, so the memory and the timing of each belong to it alone
+    const Movie script = script_input(settings);
+    std::vector<Result> results(programs.size());
+    for (size_t idx = 0; idx < programs.size(); idx++)
+    {
+        Result &result = results[idx];
+        run_rom(programs[idx], local[idx], cache, settings, engine, script, repetitions, result);
+        printf("%s\t%s\t%.0f\t%" PRIu64 "\t%.3f\n", result.name.c_str(), result.status.c_str(), result.instructions_per_second, result.peak_rss_kb,
+               result.allocations_per_million);
+        fflush(stdout);
+    }
+
+    curl_global_cleanup();
+
+    const size_t invalid = std::count_if(results.begin(), results.end(), [](const Result &result)
+                                         { return result.status == "invalid"; });
+    fprintf(stderr, "%zu ROMs, %zu stopped at an invalid instruction\n", results.size(), invalid);
+
+    if (write_path && !write_baseline(write_path, settings, results))
+    {
+        fprintf(stderr, "Couldn't write baseline %s\n", write_path);
+        return 1;
+    }
+
+    if (baseline_path && compare(results, baseline, threshold) > 0)
+        return 2;
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../core/Chip8.hpp"
+#include "../core/Disassembler.hpp"
+#include "../core/Framebuffer.hpp"
+#include "../core/Random.hpp"
+#include "../core/Scheduler.hpp"
+#include "../RomCache.hpp"
+#include "./Benchmark.hpp"
+
+// Times the core's hot paths in isolation, without needing the network or a display
+// Usage: chip8_bench [--warmup N] [--repetitions N] [--filter TEXT] [--json results.json]
+// Progress goes to stderr, and the JSON goes to the file or to stdout when the file is -
+// Build it with -DCMAKE_BUILD_TYPE=Release, numbers from an unoptimized build say little about the real thing
+
+// A program that runs the same instructions over and over, filling memory and jumping back to the start
+static std::vector<byte> repeat_instructions(std::initializer_list<inst_t> instructions)
+{
+    std::vector<byte> program;
+    while (program.size() + instructions.size() * 2 <= 0x1000 - 0x200 - 2)
+    {
+        for (inst_t instruction : instructions)
+        {
+            program.push_back(instruction >> 8);
+            program.push_back(instruction & 0xFF);
+        }
+    }
+    program.push_back(0x12);
+    program.push_back(0x00);
+    return program;
+}
+
+static void bench_clock(Benchmark &benchmark)
+{
+    struct Class
+    {
+        const char *name;
+        std::vector<byte> program;
+    };
+
+    // Registers start at zero, so skips don't skip, V0 + 200 jumps to the start and I points at the font
+    const std::vector<Class> classes{
+        {"CLS", repeat_instructions({0x00E0})},
+        {"JP", {0x12, 0x00}},
+        // CALL 206, JP 200 and RET, one of each
+        {"CALL+RET+JP", {0x22, 0x06, 0x12, 0x00, 0x00, 0x00, 0x00, 0xEE}},
+        {"SE_BYTE", repeat_instructions({0x3A01})},
+        {"LD_BYTE", repeat_instructions({0x6A12})},
+        {"ADD_BYTE", repeat_instructions({0x7A01})},
+        {"LD_REG", repeat_instructions({0x8AB0})},
+        {"ADD_REG", repeat_instructions({0x8AB4})},
+        {"SHR", repeat_instructions({0x8AB6})},
+        {"LD_I", repeat_instructions({0xA300})},
+        {"JP_V0", {0xB2, 0x00}},
+        {"RND", repeat_instructions({0xCA0F})},
+        {"DRW", repeat_instructions({0xDAB5})},
+        {"SKP", repeat_instructions({0xEA9E})},
+        {"LD_VX_DT", repeat_instructions({0xFA07})},
+        {"LD_DT_VX", repeat_instructions({0xFA15})},
+        {"ADD_I", repeat_instructions({0xFA1E})},
+        {"LD_F", repeat_instructions({0xFA29})},
+        {"LD_B", repeat_instructions({0xFA33})},
+        // Fx55 leaves I past what it stored, so I is reset before it walks into the program
+        {"LD_I+LD_MEM_VX", repeat_instructions({0xA000, 0xFF55})},
+        {"LD_VX_MEM", repeat_instructions({0xFF65})},
+    };
+
+    for (const Class &instruction_class : classes)
+    {
+        Chip8 chip8(std::make_shared<KeypadState>());
+        chip8.load_program(instruction_class.program);
+        benchmark.run(std::string("clock/") + instruction_class.name, 10000, [&](uint64_t iterations)
+                      {
+                          for (uint64_t idx = 0; idx < iterations; idx++)
+                              chip8.clock();
+                          keep(chip8.get_cycles());
+                      });
+    }
+}
+
+static void bench_scheduler(Benchmark &benchmark)
+{
+    // Turbo at the default speed, where frames are short enough that anything done per frame shows up
+    for (const bool rewind : {false, true})
+    {
+        Chip8 chip8(std::make_shared<KeypadState>());
+        chip8.load_program(repeat_instructions({0x7A01, 0x8AB4, 0xA300}));
+        Scheduler scheduler;
+        scheduler.set_turbo(true);
+        scheduler.set_rewind_enabled(rewind);
+
+        benchmark.run(rewind ? "scheduler/turbo+rewind" : "scheduler/turbo", 10000, [&](uint64_t iterations)
+                      {
+                          uint64_t frames = 0;
+                          scheduler.run(chip8, [&]
+                                        { return frames++ < iterations; });
+                          keep(chip8.get_cycles());
+                      });
+    }
+}
+
+static void bench_draw_sprite(Benchmark &benchmark)
+{
+    Random random(1);
+
+    // Where sprites are drawn, each one is drawn twice so the screen ends up as it started
+    std::vector<std::pair<uint8_t, uint8_t>> positions(256);
+    for (auto &[x, y] : positions)
+    {
+        x = random.next_byte();
+        y = random.next_byte();
+    }
+    std::array<byte, 0xF> sprite;
+    for (byte &row : sprite)
+        row = random.next_byte();
+
+    for (const int percent : {0, 25, 50, 100})
+    {
+        // Every pixel is on with the given chance
+        Framebuffer framebuffer;
+        for (uint64_t &row : framebuffer.rows)
+        {
+            for (size_t bit = 0; bit < Framebuffer::WIDTH; bit++)
+            {
+                if (random.next() % 100 < static_cast<uint64_t>(percent))
+                    row |= uint64_t(1) << bit;
+            }
+        }
+
+        benchmark.run("draw_sprite/occupancy-" + std::to_string(percent), positions.size() * 2, [&](uint64_t)
+                      {
+                          bool collision = false;
+                          for (int pass = 0; pass < 2; pass++)
+                          {
+                              for (const auto &[x, y] : positions)
+                                  collision |= framebuffer.draw_sprite(sprite.data(), x, y, sprite.size());
+                          }
+                          keep(collision);
+                          keep(framebuffer.rows);
+                      });
+    }
+}
+
+static void bench_disassemble(Benchmark &benchmark)
+{
+    Random random(2);
+    std::vector<inst_t> instructions(4096);
+    for (inst_t &instruction : instructions)
+        instruction = random.next() & 0xFFFF;
+
+    benchmark.run("disassemble_instruction", instructions.size(), [&](uint64_t)
+                  {
+                      for (inst_t instruction : instructions)
+                          keep(disassemble_instruction(instruction));
+                  });
+
+    benchmark.run("disassemble_instruction/format", instructions.size(), [&](uint64_t)
+                  {
+                      for (inst_t instruction : instructions)
+                      {
+                          const std::optional<Instruction> disassembled = disassemble_instruction(instruction);
+                          if (disassembled)
+                              keep(static_cast<std::string>(*disassembled));
+                      }
+                  });
+}
+
+static void bench_write_callback(Benchmark &benchmark)
+{
+    std::vector<char> chunk(16 * 1024, 'x');
+
+    // A typical ROM arriving in small pieces, and a large one arriving in the biggest pieces curl hands out
+    for (const auto &[name, size, chunk_size] : {std::tuple<const char *, size_t, size_t>{"write_callback/4KB-in-1KB", 4 * 1024, 1024},
+                                                 std::tuple<const char *, size_t, size_t>{"write_callback/64KB-in-16KB", 64 * 1024, 16 * 1024}})
+    {
+        benchmark.run(name, 100, [&, size = size, chunk_size = chunk_size](uint64_t iterations)
+                      {
+                          for (uint64_t idx = 0; idx < iterations; idx++)
+                          {
+                              std::vector<byte> body;
+                              for (size_t written = 0; written < size; written += chunk_size)
+                                  RomCache::write_callback(chunk.data(), 1, chunk_size, &body);
+                              keep(body.data());
+                          }
+                      });
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Benchmark benchmark;
+    const char *json = nullptr;
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "--warmup") && idx + 1 < argc)
+        {
+            benchmark.set_warmup(std::strtoul(argv[++idx], nullptr, 10));
+        }
+        else if (!strcmp(argv[idx], "--repetitions") && idx + 1 < argc)
+        {
+            benchmark.set_repetitions(std::strtoul(argv[++idx], nullptr, 10));
+        }
+        else if (!strcmp(argv[idx], "--filter") && idx + 1 < argc)
+        {
+            benchmark.set_filter(argv[++idx]);
+        }
+        else if (!strcmp(argv[idx], "--json") && idx + 1 < argc)
+        {
+            json = argv[++idx];
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--warmup N] [--repetitions N] [--filter TEXT] [--json results.json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: built without optimizations\n");
+#endif
+
+    bench_clock(benchmark);
+    bench_scheduler(benchmark);
+    bench_draw_sprite(benchmark);
+    bench_disassemble(benchmark);
+    bench_write_callback(benchmark);
+
+    if (json)
+    {
+        FILE *file = strcmp(json, "-") ? fopen(json, "w") : stdout;
+        if (!file)
+        {
+            fprintf(stderr, "Couldn't write %s\n", json);
+            return 1;
+        }
+        benchmark.write_json(file);
+        if (file != stdout && fclose(file) != 0)
+        {
+            fprintf(stderr, "Couldn't write %s\n", json);
+            return 1;
+        }
+    }
+
+    return 0;
+}
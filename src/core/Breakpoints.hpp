@@ -0,0 +1,423 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./Registers.hpp"
+#include "./types.hpp"
+
+// A comparison of registers and constants, like "V3 == 0x10" or "I > 0xE00"
+// Several can be joined with &&, and the condition holds when all of them do
+// Conditions are parsed once into a list of comparisons, so checking one is a few loads and compares
+class Condition
+{
+public:
+    // Something a comparison reads
+    struct Operand
+    {
+        enum class Kind : uint8_t
+        {
+            Constant,
+            General,
+            Address,
+            ProgramCounter,
+            Delay,
+            Sound,
+        };
+
+        Kind kind = Kind::Constant;
+        // The constant, or the register number for general registers
+        uint16_t value = 0;
+
+        [[nodiscard]] inline uint16_t read(const Registers &registers) const
+        {
+            switch (kind)
+            {
+            case Kind::General:
+                return registers.general_regs[value & 0xF];
+            case Kind::Address:
+                return registers.addr_reg;
+            case Kind::ProgramCounter:
+                return registers.pc_reg;
+            case Kind::Delay:
+                return registers.delay_reg;
+            case Kind::Sound:
+                return registers.sound_reg;
+            default:
+                return value;
+            }
+        }
+    };
+
+    enum class Comparison : uint8_t
+    {
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+    };
+
+private:
+    struct Term
+    {
+        Operand lhs;
+        Comparison comparison;
+        Operand rhs;
+    };
+
+    std::vector<Term> terms;
+    std::string text;
+
+    static void skip_spaces(const std::string &text, size_t &pos)
+    {
+        while (pos < text.size() && text[pos] == ' ')
+            pos++;
+    }
+
+    // Registers are V0-VF, I, PC, DT and ST, and constants are decimal or hex with 0x
+    static bool parse_operand(const std::string &text, size_t &pos, Operand &operand)
+    {
+        skip_spaces(text, pos);
+        const auto starts_with = [&](const char *name)
+        {
+            const size_t length = std::char_traits<char>::length(name);
+            if (text.compare(pos, length, name) != 0)
+                return false;
+            pos += length;
+            return true;
+        };
+
+        if (pos + 1 < text.size() && (text[pos] == 'V' || text[pos] == 'v') && std::isxdigit(static_cast<unsigned char>(text[pos + 1])) &&
+            (pos + 2 == text.size() || !std::isalnum(static_cast<unsigned char>(text[pos + 2]))))
+        {
+            operand = {Operand::Kind::General, static_cast<uint16_t>(std::strtoul(text.substr(pos + 1, 1).c_str(), nullptr, 16))};
+            pos += 2;
+            return true;
+        }
+        if (starts_with("PC") || starts_with("pc"))
+        {
+            operand = {Operand::Kind::ProgramCounter, 0};
+            return true;
+        }
+        if (starts_with("DT") || starts_with("dt"))
+        {
+            operand = {Operand::Kind::Delay, 0};
+            return true;
+        }
+        if (starts_with("ST") || starts_with("st"))
+        {
+            operand = {Operand::Kind::Sound, 0};
+            return true;
+        }
+        if (starts_with("I") || starts_with("i"))
+        {
+            operand = {Operand::Kind::Address, 0};
+            return true;
+        }
+
+        // A leading 0 is still decimal, and the digits have to start right away since strtoul would skip spaces and take a sign
+        const int base = text.compare(pos, 2, "0x") == 0 || text.compare(pos, 2, "0X") == 0 ? 16 : 10;
+        const char *start = text.c_str() + pos + (base == 16 ? 2 : 0);
+        if (!(base == 16 ? std::isxdigit(static_cast<unsigned char>(*start)) : std::isdigit(static_cast<unsigned char>(*start))))
+            return false;
+        char *end;
+        const unsigned long value = std::strtoul(start, &end, base);
+        if (value > 0xFFFF)
+            return false;
+        operand = {Operand::Kind::Constant, static_cast<uint16_t>(value)};
+        pos = end - text.c_str();
+        return true;
+    }
+
+    static bool parse_comparison(const std::string &text, size_t &pos, Comparison &comparison)
+    {
+        skip_spaces(text, pos);
+        static constexpr const std::array<std::pair<const char *, Comparison>, 6> COMPARISONS{{
+            {"==", Comparison::Equal},
+            {"!=", Comparison::NotEqual},
+            {"<=", Comparison::LessEqual},
+            {">=", Comparison::GreaterEqual},
+            {"<", Comparison::Less},
+            {">", Comparison::Greater},
+        }};
+        for (const auto &[symbol, value] : COMPARISONS)
+        {
+            const size_t length = std::char_traits<char>::length(symbol);
+            if (text.compare(pos, length, symbol) == 0)
+            {
+                comparison = value;
+                pos += length;
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    // Returns nothing if the text isn't a condition
+    [[nodiscard]] static std::optional<Condition> parse(const std::string &text)
+    {
+        Condition condition;
+        condition.text = text;
+
+        size_t pos = 0;
+        do
+        {
+            Term term;
+            if (!parse_operand(text, pos, term.lhs) || !parse_comparison(text, pos, term.comparison) || !parse_operand(text, pos, term.rhs))
+                return std::nullopt;
+            condition.terms.push_back(term);
+            skip_spaces(text, pos);
+        } while (text.compare(pos, 2, "&&") == 0 && (pos += 2));
+
+        if (pos != text.size())
+            return std::nullopt;
+        return condition;
+    }
+
+    [[nodiscard]] bool operator()(const Registers &registers) const
+    {
+        for (const Term &term : terms)
+        {
+            const uint16_t lhs = term.lhs.read(registers);
+            const uint16_t rhs = term.rhs.read(registers);
+            bool holds;
+            switch (term.comparison)
+            {
+            case Comparison::Equal:
+                holds = lhs == rhs;
+                break;
+            case Comparison::NotEqual:
+                holds = lhs != rhs;
+                break;
+            case Comparison::Less:
+                holds = lhs < rhs;
+                break;
+            case Comparison::LessEqual:
+                holds = lhs <= rhs;
+                break;
+            case Comparison::Greater:
+                holds = lhs > rhs;
+                break;
+            default:
+                holds = lhs >= rhs;
+                break;
+            }
+            if (!holds)
+                return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] const std::string &get_text() const
+    {
+        return text;
+    }
+};
+
+// A range of memory to break on when an instruction is about to read or write it
+struct Watchpoint
+{
+    addr_t start = 0;
+    // Inclusive
+    addr_t end = 0;
+    bool read = false;
+    bool write = false;
+};
+
+// Everything that can make the debugger break, shared between the thread drawing the debugger and the one running the Chip 8
+// PC breakpoints are a bitmap that's safe to change while it's being checked
+// Conditions and watchpoints are behind a mutex, which is only taken while some exist
+class Breakpoints
+{
+private:
+    std::array<std::atomic<uint64_t>, 0x1000 / 64> bitmap{};
+    std::atomic<size_t> breakpoint_count{0};
+
+    mutable std::mutex mtx;
+    std::vector<Condition> conditions;
+    // Whether each condition held at the last instruction, they break when they start holding rather than on every instruction they hold for
+    std::vector<bool> held;
+    std::vector<Watchpoint> watchpoints;
+    std::atomic<bool> has_extras{false};
+
+    void update_extras()
+    {
+        has_extras = !conditions.empty() || !watchpoints.empty();
+    }
+
+    // The memory an instruction is going to read or write, as an inclusive range
+    static bool accesses(inst_t instruction, const Registers &registers, bool &reads, bool &writes, addr_t &start, addr_t &end)
+    {
+        const uint8_t x = instruction >> 8 & 0xF;
+        reads = writes = false;
+        start = registers.addr_reg;
+        if ((instruction & 0xF000) == 0xD000)
+        {
+            // Dxyn - DRW reads the sprite
+            reads = (instruction & 0xF) != 0;
+            end = start + (instruction & 0xF) - 1;
+        }
+        else if ((instruction & 0xF0FF) == 0xF033)
+        {
+            // Fx33 - LD B writes 3 digits
+            writes = true;
+            end = start + 2;
+        }
+        else if ((instruction & 0xF0FF) == 0xF055)
+        {
+            // Fx55 - LD [I] writes V0 through Vx
+            writes = true;
+            end = start + x;
+        }
+        else if ((instruction & 0xF0FF) == 0xF065)
+        {
+            // Fx65 - LD Vx, [I] reads V0 through Vx
+            reads = true;
+            end = start + x;
+        }
+        return reads || writes;
+    }
+
+public:
+    [[nodiscard]] bool has_breakpoint(addr_t addr) const
+    {
+        addr &= 0xFFF;
+        return bitmap[addr / 64].load(std::memory_order_relaxed) >> (addr % 64) & 1;
+    }
+
+    void set_breakpoint(addr_t addr, bool set)
+    {
+        addr &= 0xFFF;
+        const uint64_t bit = uint64_t(1) << (addr % 64);
+        const uint64_t previous = set ? bitmap[addr / 64].fetch_or(bit) : bitmap[addr / 64].fetch_and(~bit);
+        if (set && !(previous & bit))
+            breakpoint_count++;
+        else if (!set && (previous & bit))
+            breakpoint_count--;
+    }
+
+    // Returns false if the text isn't a condition
+    bool add_condition(const std::string &text)
+    {
+        std::optional<Condition> condition = Condition::parse(text);
+        if (!condition)
+            return false;
+
+        std::unique_lock<std::mutex> lock(mtx);
+        conditions.push_back(std::move(*condition));
+        held.push_back(false);
+        update_extras();
+        return true;
+    }
+
+    void remove_condition(size_t idx)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (idx >= conditions.size())
+            return;
+        conditions.erase(conditions.begin() + idx);
+        held.erase(held.begin() + idx);
+        update_extras();
+    }
+
+    void add_watchpoint(const Watchpoint &watchpoint)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        watchpoints.push_back(watchpoint);
+        update_extras();
+    }
+
+    void remove_watchpoint(size_t idx)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (idx >= watchpoints.size())
+            return;
+        watchpoints.erase(watchpoints.begin() + idx);
+        update_extras();
+    }
+
+    // Copies, so they can be drawn without holding the lock
+    [[nodiscard]] std::vector<std::string> get_conditions() const
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        std::vector<std::string> texts;
+        for (const Condition &condition : conditions)
+            texts.push_back(condition.get_text());
+        return texts;
+    }
+
+    [[nodiscard]] std::vector<Watchpoint> get_watchpoints() const
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        return watchpoints;
+    }
+
+    // Whether anything could make check return true
+    [[nodiscard]] inline bool any() const
+    {
+        return breakpoint_count.load(std::memory_order_relaxed) != 0 || has_extras.load(std::memory_order_relaxed);
+    }
+
+    // Whether to break before executing the instruction at the program counter, and why
+    [[nodiscard]] bool check(const Registers &registers, inst_t instruction, std::string &reason)
+    {
+        if (has_breakpoint(registers.pc_reg))
+        {
+            reason = "Breakpoint";
+            return true;
+        }
+
+        if (!has_extras.load(std::memory_order_relaxed))
+            return false;
+
+        std::unique_lock<std::mutex> lock(mtx);
+        bool hit = false;
+        for (size_t idx = 0; idx < conditions.size(); idx++)
+        {
+            const bool holds = conditions[idx](registers);
+            if (holds && !held[idx] && !hit)
+            {
+                reason = conditions[idx].get_text();
+                hit = true;
+            }
+            held[idx] = holds;
+        }
+        if (hit)
+            return true;
+
+        bool reads, writes;
+        addr_t start, end;
+        if (watchpoints.empty() || !accesses(instruction, registers, reads, writes, start, end))
+            return false;
+
+        for (const Watchpoint &watchpoint : watchpoints)
+        {
+            // Accesses wrap around the end of memory, so the range is checked address by address
+            if (!((watchpoint.read && reads) || (watchpoint.write && writes)))
+                continue;
+            for (addr_t addr = start; addr != static_cast<addr_t>(end + 1); addr++)
+            {
+                if ((addr & 0xFFF) >= watchpoint.start && (addr & 0xFFF) <= watchpoint.end)
+                {
+                    char text[32];
+                    snprintf(text, sizeof(text), "%s %03X", writes ? "Write" : "Read", addr & 0xFFF);
+                    reason = text;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
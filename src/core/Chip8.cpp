@@ -0,0 +1,431 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "./Chip8.hpp"
+#include "./Instructions.hpp"
+#include "./ThreadedEngine.hpp"
+#include "./JitEngine.hpp"
+#include "./RecompiledEngine.hpp"
+#include "./font.hpp"
+#include "./get_bits.hpp"
+
+Chip8::Chip8(std::shared_ptr<KeypadState> keypad) : keypad(keypad), threaded_engine(std::make_unique<ThreadedEngine>(*this)), jit_engine(std::make_unique<JitEngine>(*this)),
+                                                     recompiled_engine(std::make_unique<RecompiledEngine>(*this))
+{
+    // Copy the font to the beginning of memory
+    std::copy(font.begin(), font.end(), memory->begin());
+}
+
+Chip8::~Chip8() = default;
+
+bool Chip8::drawSprite(addr_t sprite_addr, uint8_t x, uint8_t y, uint8_t n)
+{
+    // Gather the sprite, wrapping around the end of memory
+    std::array<byte, 0xF> sprite;
+    for (uint8_t i = 0; i < n; i++)
+        sprite[i] = (*memory)[(sprite_addr + i) % memory->size()];
+
+    if (counting)
+        counting->drew(sprite.data(), n);
+
+    std::unique_lock<std::mutex> lock = lock_framebuffer();
+    return framebuffer.draw_sprite(sprite.data(), x, y, n);
+}
+
+std::unique_lock<std::mutex> Chip8::lock_framebuffer() const
+{
+    // Only waits are timed, so taking a free lock costs the same as before
+    std::unique_lock<std::mutex> lock(framebuffer_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        lock.lock();
+        Metrics::add(metrics->framebuffer_waits, 1);
+        Metrics::add(metrics->framebuffer_wait_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    return lock;
+}
+
+void Chip8::load_program(const std::vector<byte> &program)
+{
+    std::copy(program.begin(), program.begin() + std::min(program.size(), memory->size() - 0x200), memory->begin() + 0x200);
+    decoded.fill(DecodedInstruction());
+    threaded_engine->clear();
+    jit_engine->clear();
+    recompiled_engine->load(program);
+    generations->written_all();
+}
+
+uint32_t Chip8::run(uint32_t count)
+{
+    update_instrumentation();
+
+    uint32_t executed = 0;
+    while (executed < count && state != CpuState::Halted)
+    {
+        keypad->apply_events(cycles);
+
+        // Stop at the next key event so it's applied at exactly the instruction count it's stamped with
+        uint32_t chunk = count - executed;
+        if (const std::optional<uint64_t> next = keypad->next_event_cycle(); next && *next > cycles)
+            chunk = std::min<uint64_t>(chunk, *next - cycles);
+
+        // While waiting for a key, time passes without anything being executed until a key is pressed
+        if (state == CpuState::WaitingForKey && !resume_key_wait())
+        {
+            executed += chunk;
+            cycles += chunk;
+            continue;
+        }
+
+        const uint32_t ran = run_engine(chunk);
+        executed += ran;
+        cycles += ran;
+
+        // The engines stop right before Fx0A, which either takes a key pressed right then or starts waiting
+        if (ran < chunk && state != CpuState::Halted)
+        {
+            keypad->apply_events(cycles);
+            step();
+            executed++;
+            cycles++;
+        }
+    }
+
+    // Clocks spent waiting for a key count too, so the rate can be compared with the target
+    Metrics::add(metrics->instructions, executed);
+    return executed;
+}
+
+bool Chip8::resume_key_wait()
+{
+    if (!keypad->has_presses())
+        return false;
+
+    // Run the Fx0A again, this time it'll find the key
+    state = CpuState::Running;
+    return true;
+}
+
+uint32_t Chip8::run_engine(uint32_t count)
+{
+    // A clock handler that isn't armed doesn't need to see every instruction, it's picked up again at the next run once it's armed
+    // Profiling and tracing are the same, they start at the next run once they're enabled
+    const bool handled = (clock_handler && clock_handler->is_armed()) || counting || tracing;
+    // Cycles spent waiting for a key aren't executed, so the trace is caught up before every run
+    if (tracing)
+        tracing->set_cycle(cycles);
+    if (engine == Engine::Threaded && !handled)
+        return threaded_engine->run(count);
+    if (engine == Engine::Jit && !handled && jit_engine->available())
+        return jit_engine->run(count);
+    if (engine == Engine::Recompiled && !handled && recompiled_engine->loaded())
+        return recompiled_engine->run(count);
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        if (at_key_wait())
+            return idx;
+
+        step();
+        if (state == CpuState::Halted)
+            return idx + 1;
+    }
+
+    return count;
+}
+
+void Chip8::save_state(SaveState &state) const
+{
+    state.magic = SaveState::MAGIC;
+    state.version = SaveState::VERSION;
+    state.cycles = cycles;
+    state.random_state = random.get_state();
+    state.memory = *memory;
+    state.framebuffer = get_framebuffer();
+    state.registers = *registers;
+    state.stack = stack;
+    state.keys = keypad->get_keys();
+    state.stack_pointer = stack_pointer;
+    state.state = static_cast<uint8_t>(this->state);
+    state.reserved.fill(0);
+}
+
+void Chip8::load_state(const SaveState &state)
+{
+    cycles = state.cycles;
+    random.set_state(state.random_state);
+
+    // Only the memory that differs is written, so whatever was decoded or translated from the rest stays valid
+    // Forks of a warm state only change a little memory, which keeps restoring them cheap
+    for (addr_t page = 0; page < memory->size(); page += 0x100)
+    {
+        if (!std::memcmp(memory->data() + page, state.memory.data() + page, 0x100))
+            continue;
+
+        for (addr_t addr = page; addr < page + 0x100; addr++)
+        {
+            if ((*memory)[addr] != state.memory[addr])
+                store(addr, state.memory[addr]);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock = lock_framebuffer();
+        framebuffer = state.framebuffer;
+    }
+    *registers = state.registers;
+    stack = state.stack;
+    keypad->set_keys(state.keys);
+    keypad->rebase(cycles);
+    stack_pointer = state.stack_pointer & 0xF;
+    this->state = state.state <= static_cast<uint8_t>(CpuState::Halted) ? static_cast<CpuState>(state.state) : CpuState::Running;
+
+    // Restoring memory can undo self modification, so recompiled blocks that were dropped for it may match again
+    recompiled_engine->revalidate();
+}
+
+bool Chip8::jit_available() const
+{
+    return jit_engine->available();
+}
+
+bool Chip8::recompiled_available() const
+{
+    return recompiled_engine->loaded();
+}
+
+bool Chip8::engine_available() const
+{
+    switch (engine)
+    {
+    case Engine::Jit:
+        return jit_available();
+    case Engine::Recompiled:
+        return recompiled_available();
+    default:
+        return true;
+    }
+}
+
+void Chip8::memory_written(addr_t addr, size_t length)
+{
+    for (size_t idx = 0; idx < length; idx++)
+    {
+        const addr_t written = (addr + idx) & 0xFFF;
+        decoded[written >> 1].op = Op::Undecoded;
+        if (translated_code[written])
+            code_written(written);
+        generations->written(written);
+    }
+}
+
+void Chip8::queue_memory_written(addr_t addr, size_t length)
+{
+    // The generations are atomic, so the debugger sees the write right away even while the Chip 8 is stopped
+    for (size_t idx = 0; idx < length; idx++)
+        generations->written((addr + idx) & 0xFFF);
+
+    std::unique_lock<std::mutex> lock(pending_writes_mtx);
+    pending_writes.emplace_back(addr, length);
+    writes_pending = true;
+}
+
+void Chip8::take_pending_writes()
+{
+    if (!writes_pending.load(std::memory_order_relaxed))
+        return;
+
+    std::vector<std::pair<addr_t, size_t>> writes;
+    {
+        std::unique_lock<std::mutex> lock(pending_writes_mtx);
+        writes.swap(pending_writes);
+        writes_pending = false;
+    }
+    for (const auto &[addr, length] : writes)
+        memory_written(addr, length);
+}
+
+void Chip8::store(addr_t addr, byte value)
+{
+    addr &= 0xFFF;
+    (*memory)[addr] = value;
+    decoded[addr >> 1].op = Op::Undecoded;
+    if (translated_code[addr])
+        code_written(addr);
+    generations->written(addr);
+}
+
+void Chip8::code_written(addr_t addr)
+{
+    threaded_engine->invalidate(addr);
+    jit_engine->invalidate(addr);
+    recompiled_engine->invalidate(addr);
+    translated_code[addr] = false;
+}
+
+void Chip8::clock()
+{
+    update_instrumentation();
+    if (state == CpuState::Halted)
+        return;
+
+    keypad->apply_events(cycles);
+    if (state == CpuState::Running || resume_key_wait())
+        step();
+    cycles++;
+    Metrics::add(metrics->instructions, 1);
+}
+
+void Chip8::step()
+{
+    // The handler can stop execution while memory is edited, so the edits are taken before the next instruction is fetched
+    if (clock_handler && clock_handler->is_armed())
+    {
+        clock_handler->on_clock();
+        take_pending_writes();
+    }
+
+    const addr_t pc = registers->pc_reg & 0xFFF;
+
+    // Instructions at even addresses come out of the cache, decoding them on first use
+    // Jumping to an odd address is rare enough to just decode every time
+    DecodedInstruction odd;
+    DecodedInstruction &instruction = (pc & 1) == 0 ? decoded[pc >> 1] : odd;
+    if (instruction.op == Op::Undecoded)
+        instruction = decode(fetch(pc));
+
+    if (counting)
+        counting->executed(pc, instruction);
+
+    if (!tracing)
+    {
+        execute(instruction);
+        return;
+    }
+
+    // Taken before executing, since the instruction could overwrite itself and reset its cache slot
+    const inst_t opcode = fetch(pc);
+    const uint8_t changed = Trace::written_register(instruction.op, instruction.x);
+    execute(instruction);
+    tracing->record(pc, opcode, changed, *registers);
+}
+
+void Chip8::execute(const DecodedInstruction &instruction)
+{
+    switch (instruction.op)
+    {
+    case Op::CLS:
+        execute_op<Op::CLS>(instruction);
+        break;
+    case Op::RET:
+        execute_op<Op::RET>(instruction);
+        break;
+    case Op::JP:
+        execute_op<Op::JP>(instruction);
+        break;
+    case Op::CALL:
+        execute_op<Op::CALL>(instruction);
+        break;
+    case Op::SE_BYTE:
+        execute_op<Op::SE_BYTE>(instruction);
+        break;
+    case Op::SNE_BYTE:
+        execute_op<Op::SNE_BYTE>(instruction);
+        break;
+    case Op::SE_REG:
+        execute_op<Op::SE_REG>(instruction);
+        break;
+    case Op::LD_BYTE:
+        execute_op<Op::LD_BYTE>(instruction);
+        break;
+    case Op::ADD_BYTE:
+        execute_op<Op::ADD_BYTE>(instruction);
+        break;
+    case Op::LD_REG:
+        execute_op<Op::LD_REG>(instruction);
+        break;
+    case Op::OR:
+        execute_op<Op::OR>(instruction);
+        break;
+    case Op::AND:
+        execute_op<Op::AND>(instruction);
+        break;
+    case Op::XOR:
+        execute_op<Op::XOR>(instruction);
+        break;
+    case Op::ADD_REG:
+        execute_op<Op::ADD_REG>(instruction);
+        break;
+    case Op::SUB:
+        execute_op<Op::SUB>(instruction);
+        break;
+    case Op::SHR:
+        execute_op<Op::SHR>(instruction);
+        break;
+    case Op::SUBN:
+        execute_op<Op::SUBN>(instruction);
+        break;
+    case Op::SHL:
+        execute_op<Op::SHL>(instruction);
+        break;
+    case Op::SNE_REG:
+        execute_op<Op::SNE_REG>(instruction);
+        break;
+    case Op::LD_I:
+        execute_op<Op::LD_I>(instruction);
+        break;
+    case Op::JP_V0:
+        execute_op<Op::JP_V0>(instruction);
+        break;
+    case Op::RND:
+        execute_op<Op::RND>(instruction);
+        break;
+    case Op::DRW:
+        execute_op<Op::DRW>(instruction);
+        break;
+    case Op::SKP:
+        execute_op<Op::SKP>(instruction);
+        break;
+    case Op::SKNP:
+        execute_op<Op::SKNP>(instruction);
+        break;
+    case Op::LD_VX_DT:
+        execute_op<Op::LD_VX_DT>(instruction);
+        break;
+    case Op::LD_VX_K:
+        execute_op<Op::LD_VX_K>(instruction);
+        break;
+    case Op::LD_DT_VX:
+        execute_op<Op::LD_DT_VX>(instruction);
+        break;
+    case Op::LD_ST_VX:
+        execute_op<Op::LD_ST_VX>(instruction);
+        break;
+    case Op::ADD_I:
+        execute_op<Op::ADD_I>(instruction);
+        break;
+    case Op::LD_F:
+        execute_op<Op::LD_F>(instruction);
+        break;
+    case Op::LD_B:
+        execute_op<Op::LD_B>(instruction);
+        break;
+    case Op::LD_MEM_VX:
+        execute_op<Op::LD_MEM_VX>(instruction);
+        break;
+    case Op::LD_VX_MEM:
+        execute_op<Op::LD_VX_MEM>(instruction);
+        break;
+    case Op::Invalid:
+    default:
+        // Stay on the instruction so the caller can see where the program went wrong
+        state = CpuState::Halted;
+        registers->pc_reg -= 2;
+        break;
+    }
+
+    // Increment the program counter, which wraps around with memory so every engine leaves the same value behind
+    registers->pc_reg = (registers->pc_reg + 2) & 0xFFF;
+}
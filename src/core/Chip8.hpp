@@ -0,0 +1,324 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "./types.hpp"
+#include "./Decoder.hpp"
+#include "./Framebuffer.hpp"
+#include "./MemoryGenerations.hpp"
+#include "./Metrics.hpp"
+#include "./Profile.hpp"
+#include "./Random.hpp"
+#include "./Registers.hpp"
+#include "./SaveState.hpp"
+#include "./Trace.hpp"
+#include "./KeypadState.hpp"
+#include "./ClockHandler.hpp"
+
+class ThreadedEngine;
+class JitEngine;
+class RecompiledEngine;
+
+// What the CPU is doing between instructions
+enum class CpuState : uint8_t
+{
+    Running,
+    // Fx0A found no key pressed, nothing executes until one is and then the Fx0A runs again
+    WaitingForKey,
+    // An invalid instruction, including 0nnn, was executed and the program counter was left on it
+    // Nothing executes again until a state without it is loaded
+    Halted,
+};
+
+// The ways the Chip 8 can execute instructions
+enum class Engine : uint8_t
+{
+    // Decode and execute a single instruction at a time, this is the reference for every other engine
+    Interpreter,
+    // Translate basic blocks into threaded code once and run them from then on
+    Threaded,
+    // Compile hot basic blocks to x86-64 machine code, only available on 64 bit x86 Linux
+    Jit,
+    // Run blocks recompiled ahead of time by chip8_recompile, only available for ROMs that were recompiled and linked in
+    Recompiled,
+};
+
+class Chip8
+{
+    friend class ThreadedEngine;
+    friend class JitEngine;
+    friend class RecompiledEngine;
+
+public:
+    // Some constants
+    static constexpr const size_t SCREEN_WIDTH = Framebuffer::WIDTH;
+    static constexpr const size_t SCREEN_HEIGHT = Framebuffer::HEIGHT;
+
+private:
+    // Registers
+    std::shared_ptr<Registers> registers = std::make_shared<Registers>();
+
+    // On the Chip 8, the stack is only used to store return addresses on function calls
+    // The program is unable to interact with the stack pointer aside from pushing the
+    // return address when calling a function and popping on return
+    // Instead of placing a stack in emulator memory and having a stack pointer register,
+    // a stack outside of program memory can safely be used
+    // It has the original 16 entries and wraps around instead of overflowing
+    std::array<addr_t, 0x10> stack{};
+    uint8_t stack_pointer = 0;
+
+    // Memory
+    std::shared_ptr<std::array<byte, 0x1000>> memory = std::make_shared<std::array<byte, 0x1000>>();
+
+    // Bumped for every page of memory written to, so whatever's shown of memory knows when to redo it
+    std::shared_ptr<MemoryGenerations> generations = std::make_shared<MemoryGenerations>();
+
+    // Instructions that have already been decoded, one slot for every even address in memory
+    // A slot is reset when the memory it was decoded from is written to
+    std::array<DecodedInstruction, 0x800> decoded{};
+
+    // The keypad to get input from
+    const std::shared_ptr<KeypadState> keypad;
+
+    // The pixels on the screen
+    Framebuffer framebuffer{};
+
+    // This mutex is used to make sure the framebuffer isn't being read while the screen is being updated
+    mutable std::mutex framebuffer_mutex;
+
+    // How fast the Chip 8 runs, and how long it and the display wait on each other
+    const std::shared_ptr<Metrics> metrics = std::make_shared<Metrics>();
+
+    // Lock the framebuffer, counting the wait if another thread holds it
+    [[nodiscard]] std::unique_lock<std::mutex> lock_framebuffer() const;
+
+    // The number of instructions executed since the Chip 8 was created, key events are stamped with this
+    // Time spent waiting for a key counts too, as if an instruction ran in every slot
+    uint64_t cycles = 0;
+
+    CpuState state = CpuState::Running;
+
+    // Where Cxkk gets its random numbers from
+    Random random;
+
+    // Leave the waiting state if a key was pressed right before the current instruction, returns whether it was
+    bool resume_key_wait();
+
+    // Whether the next instruction is Fx0A, engines stop right before it
+    [[nodiscard]] bool at_key_wait() const
+    {
+        return (*memory)[registers->pc_reg & 0xFFF] >> 4 == 0xF && (*memory)[(registers->pc_reg + 1) & 0xFFF] == 0x0A;
+    }
+
+    // Notified at the start of every clock, used for debugging
+    std::shared_ptr<ClockHandler> clock_handler;
+
+    // Counts what's executed while it's enabled, used for profiling
+    std::shared_ptr<Profile> profile;
+
+    // Records what's executed while it's enabled, used for debugging
+    std::shared_ptr<Trace> trace;
+
+    // The profile and trace while they're enabled and nullptr otherwise
+    // They're checked once per run so instructions only test a pointer
+    Profile *counting = nullptr;
+    Trace *tracing = nullptr;
+
+    void update_instrumentation()
+    {
+        take_pending_writes();
+
+        if (profile)
+            profile->take_reset();
+        counting = profile && profile->is_enabled() ? profile.get() : nullptr;
+
+        if (trace)
+            trace->take_dump_request();
+        tracing = trace && trace->is_enabled() ? trace.get() : nullptr;
+        if (tracing)
+            tracing->set_cycle(cycles);
+    }
+
+    // The engine used by run
+    std::atomic<Engine> engine{Engine::Interpreter};
+    std::unique_ptr<ThreadedEngine> threaded_engine;
+    std::unique_ptr<JitEngine> jit_engine;
+    std::unique_ptr<RecompiledEngine> recompiled_engine;
+
+    // A bit for each byte of memory that's part of a block translated, compiled or recompiled by one of the engines
+    std::bitset<0x1000> translated_code{};
+
+    // Tell the engines that translated code was written to
+    void code_written(addr_t addr);
+
+    // Memory written from other threads, like the debugger's memory editor, waiting for the thread running the Chip 8 to apply it
+    // The engines' blocks can only be changed by that thread, it takes these at the start of every run and clock
+    std::mutex pending_writes_mtx;
+    std::vector<std::pair<addr_t, size_t>> pending_writes;
+    std::atomic<bool> writes_pending{false};
+
+    void take_pending_writes();
+
+    [[nodiscard]] inline inst_t fetch(addr_t addr) const
+    {
+        return ((*memory)[addr & 0xFFF] << 8) | (*memory)[(addr + 1) & 0xFFF];
+    }
+
+    // Write a byte of memory from an instruction
+    void store(addr_t addr, byte value);
+
+    // Execute the instruction at the program counter, without applying key events or counting it
+    // Engines use this when they fall back to the interpreter, since they count instructions themselves
+    void step();
+
+    // Execute up to count instructions with the selected engine, stopping early before Fx0A
+    uint32_t run_engine(uint32_t count);
+
+    // Execute an already decoded instruction
+    void execute(const DecodedInstruction &instruction);
+
+    // Execute a single kind of instruction, without incrementing the program counter
+    template <Op op>
+    inline void execute_op(const DecodedInstruction &instruction);
+
+    // Draw a chip8 sprite on the display
+    // Returns true if there was a collision
+    bool drawSprite(addr_t sprite_addr, uint8_t x, uint8_t y, uint8_t n);
+
+public:
+    // 0 out all the registers except for the program counter
+    Chip8(std::shared_ptr<KeypadState> keypad);
+    ~Chip8();
+
+    void set_clock_handler(std::shared_ptr<ClockHandler> clock_handler)
+    {
+        this->clock_handler = clock_handler;
+    }
+
+    // Must be set before the Chip 8 starts running, it can be enabled and disabled from any thread after that
+    void set_profile(std::shared_ptr<Profile> profile)
+    {
+        this->profile = profile;
+    }
+
+    // Must be set before the Chip 8 starts running, it can be enabled and disabled from any thread after that
+    void set_trace(std::shared_ptr<Trace> trace)
+    {
+        this->trace = trace;
+    }
+
+    // Restart the random numbers Cxkk produces, the same seed always produces the same numbers
+    void seed(uint64_t seed)
+    {
+        random.seed(seed);
+    }
+
+    // Copy a program into memory starting at 0x200
+    void load_program(const std::vector<byte> &program);
+
+    // Execute a clock of the Chip 8, which does nothing while waiting for a key
+    void clock();
+
+    // Execute count clocks of the Chip 8 with the selected engine
+    // Key events are applied at exactly the instruction count they're stamped with
+    // Clocks spent waiting for a key return immediately, so this never blocks
+    // The interpreter is always used while a clock handler is armed or profiling or tracing is enabled, since other engines don't stop at every clock
+    // Returns the number of clocks executed, which is always count
+    uint32_t run(uint32_t count);
+
+    // Whether the JIT can run on this host, the interpreter is used in its place when it can't
+    [[nodiscard]] bool jit_available() const;
+
+    // Whether the loaded program was recompiled ahead of time, the interpreter is used in place of the recompiled engine when it wasn't
+    [[nodiscard]] bool recompiled_available() const;
+
+    // Whether the selected engine is the one that runs, rather than the interpreter standing in for it
+    [[nodiscard]] bool engine_available() const;
+
+    void set_engine(Engine engine)
+    {
+        this->engine = engine;
+    }
+
+    [[nodiscard]] Engine get_engine() const
+    {
+        return engine;
+    }
+
+    // The delay and sound registers, when non-zero, decrement at 60 hertz
+    // This is called by the scheduler once per frame
+    void tick_timers()
+    {
+        if (registers->delay_reg > 0)
+            registers->delay_reg -= 1;
+
+        if (registers->sound_reg > 0)
+            registers->sound_reg -= 1;
+
+        Metrics::add(metrics->timer_ticks, 1);
+    }
+
+    // Snapshot everything about the Chip 8 except for the selected engine and clock handler
+    void save_state(SaveState &state) const;
+
+    // Go back to a snapshot
+    void load_state(const SaveState &state);
+
+    // The number of instructions executed since the Chip 8 was created
+    [[nodiscard]] uint64_t get_cycles() const
+    {
+        return cycles;
+    }
+
+    // Must be called after memory is written to from outside of the Chip 8, only from the thread running it or while it's stopped
+    void memory_written(addr_t addr, size_t length);
+
+    // Like memory_written, but safe to call from any thread, like the window thread the debugger's memory editor runs on
+    // The write is applied before the next instruction
+    void queue_memory_written(addr_t addr, size_t length);
+
+    // Whether Fx0A is waiting for a key to be pressed
+    [[nodiscard]] bool waiting_for_key() const
+    {
+        return state == CpuState::WaitingForKey;
+    }
+
+    // Whether an invalid instruction stopped the Chip 8, run returns early from then on
+    [[nodiscard]] bool halted() const
+    {
+        return state == CpuState::Halted;
+    }
+
+    [[nodiscard]] const std::shared_ptr<std::array<byte, 0x1000>> &get_memory() const
+    {
+        return memory;
+    }
+
+    [[nodiscard]] const std::shared_ptr<MemoryGenerations> &get_generations() const
+    {
+        return generations;
+    }
+
+    [[nodiscard]] const std::shared_ptr<Registers> &get_registers() const
+    {
+        return registers;
+    }
+
+    // Get a copy of the current contents of the display
+    [[nodiscard]] Framebuffer get_framebuffer() const
+    {
+        std::unique_lock<std::mutex> lock = lock_framebuffer();
+        return framebuffer;
+    }
+
+    [[nodiscard]] const std::shared_ptr<Metrics> &get_metrics() const
+    {
+        return metrics;
+    }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <atomic>
+
+class ClockHandler
+{
+protected:
+    // While unset on_clock isn't called at all, so a handler with nothing to do costs nothing
+    std::atomic<bool> armed{true};
+
+public:
+    // Called at the start of every clock, before the instruction is fetched
+    virtual void on_clock() = 0;
+
+    [[nodiscard]] inline bool is_armed() const
+    {
+        return armed.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+
+#include "./get_bits.hpp"
+#include "./types.hpp"
+
+// Every instruction the Chip 8 can execute
+enum class Op : uint8_t
+{
+    // Used in the instruction cache for slots that haven't been decoded yet
+    Undecoded = 0,
+    Invalid,
+    CLS,
+    RET,
+    JP,
+    CALL,
+    SE_BYTE,
+    SNE_BYTE,
+    SE_REG,
+    LD_BYTE,
+    ADD_BYTE,
+    LD_REG,
+    OR,
+    AND,
+    XOR,
+    ADD_REG,
+    SUB,
+    SHR,
+    SUBN,
+    SHL,
+    SNE_REG,
+    LD_I,
+    JP_V0,
+    RND,
+    DRW,
+    SKP,
+    SKNP,
+    LD_VX_DT,
+    LD_VX_K,
+    LD_DT_VX,
+    LD_ST_VX,
+    ADD_I,
+    LD_F,
+    LD_B,
+    LD_MEM_VX,
+    LD_VX_MEM,
+};
+
+// An instruction with its operands already pulled out
+struct DecodedInstruction
+{
+    Op op = Op::Undecoded;
+    uint8_t x = 0;
+    uint8_t y = 0;
+    uint8_t n = 0;
+    uint8_t kk = 0;
+    addr_t nnn = 0;
+};
+
+[[nodiscard]] static constexpr inline DecodedInstruction decode(inst_t instruction)
+{
+    DecodedInstruction decoded;
+    // nnn - A 12-bit value, the lowest 12 bits of the instruction
+    decoded.nnn = get_bits(instruction, 0, 12);
+    // n - A 4-bit value, the lowest 4 bits of the instruction
+    decoded.n = get_bits(instruction, 0, 4);
+    // x - A 4-bit value, the lower 4 bits of the high byte of the instruction
+    decoded.x = get_bits(instruction, 8, 4);
+    // y - A 4-bit value, the upper 4 bits of the low byte of the instruction
+    decoded.y = get_bits(instruction, 4, 4);
+    // kk - An 8-bit value, the lowest 8 bits of the instruction
+    decoded.kk = get_bits(instruction, 0, 8);
+
+    decoded.op = Op::Invalid;
+
+    // Switch on the most significant nibble of the instruction
+    switch (get_bits(instruction, 12, 4))
+    {
+    case 0x0:
+        if (decoded.nnn == 0x0E0)
+            decoded.op = Op::CLS;
+        else if (decoded.nnn == 0x0EE)
+            decoded.op = Op::RET;
+        break;
+    case 0x1:
+        decoded.op = Op::JP;
+        break;
+    case 0x2:
+        decoded.op = Op::CALL;
+        break;
+    case 0x3:
+        decoded.op = Op::SE_BYTE;
+        break;
+    case 0x4:
+        decoded.op = Op::SNE_BYTE;
+        break;
+    case 0x5:
+        decoded.op = Op::SE_REG;
+        break;
+    case 0x6:
+        decoded.op = Op::LD_BYTE;
+        break;
+    case 0x7:
+        decoded.op = Op::ADD_BYTE;
+        break;
+    case 0x8:
+        switch (decoded.n)
+        {
+        case 0x0:
+            decoded.op = Op::LD_REG;
+            break;
+        case 0x1:
+            decoded.op = Op::OR;
+            break;
+        case 0x2:
+            decoded.op = Op::AND;
+            break;
+        case 0x3:
+            decoded.op = Op::XOR;
+            break;
+        case 0x4:
+            decoded.op = Op::ADD_REG;
+            break;
+        case 0x5:
+            decoded.op = Op::SUB;
+            break;
+        case 0x6:
+            decoded.op = Op::SHR;
+            break;
+        case 0x7:
+            decoded.op = Op::SUBN;
+            break;
+        case 0xE:
+            decoded.op = Op::SHL;
+            break;
+        }
+        break;
+    case 0x9:
+        decoded.op = Op::SNE_REG;
+        break;
+    case 0xA:
+        decoded.op = Op::LD_I;
+        break;
+    case 0xB:
+        decoded.op = Op::JP_V0;
+        break;
+    case 0xC:
+        decoded.op = Op::RND;
+        break;
+    case 0xD:
+        decoded.op = Op::DRW;
+        break;
+    case 0xE:
+        if (decoded.kk == 0x9E)
+            decoded.op = Op::SKP;
+        else if (decoded.kk == 0xA1)
+            decoded.op = Op::SKNP;
+        break;
+    case 0xF:
+        switch (decoded.kk)
+        {
+        case 0x07:
+            decoded.op = Op::LD_VX_DT;
+            break;
+        case 0x0A:
+            decoded.op = Op::LD_VX_K;
+            break;
+        case 0x15:
+            decoded.op = Op::LD_DT_VX;
+            break;
+        case 0x18:
+            decoded.op = Op::LD_ST_VX;
+            break;
+        case 0x1E:
+            decoded.op = Op::ADD_I;
+            break;
+        case 0x29:
+            decoded.op = Op::LD_F;
+            break;
+        case 0x33:
+            decoded.op = Op::LD_B;
+            break;
+        case 0x55:
+            decoded.op = Op::LD_MEM_VX;
+            break;
+        case 0x65:
+            decoded.op = Op::LD_VX_MEM;
+            break;
+        }
+        break;
+    }
+
+    return decoded;
+}
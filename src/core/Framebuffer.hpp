@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "./get_bits.hpp"
+#include "./types.hpp"
+
+// The Chip 8 display, stored as a packed bitplane
+// Each row of the display is a single 64 bit word, with the leftmost pixel in the most significant bit
+class Framebuffer
+{
+public:
+    static constexpr const size_t WIDTH = 64;
+    static constexpr const size_t HEIGHT = 32;
+
+    std::array<uint64_t, HEIGHT> rows{};
+
+    void clear()
+    {
+        std::memset(rows.data(), 0, sizeof(rows));
+    }
+
+    // XOR a sprite of n rows onto the display
+    // The starting position wraps around the display, but the sprite itself is clipped at the edges
+    // Returns true if any pixel that was on got turned off
+    bool draw_sprite(const byte *sprite, uint8_t x, uint8_t y, uint8_t n)
+    {
+        x %= WIDTH;
+        y %= HEIGHT;
+
+        uint64_t collision = 0;
+        for (uint8_t i = 0; i < n && y + i < HEIGHT; i++)
+        {
+            const uint64_t row = (static_cast<uint64_t>(sprite[i]) << (WIDTH - 8)) >> x;
+            collision |= rows[y + i] & row;
+            rows[y + i] ^= row;
+        }
+
+        return collision != 0;
+    }
+
+    // A 64 bit FNV-1a hash of the display, used to compare runs
+    [[nodiscard]] uint64_t hash() const
+    {
+        uint64_t hash = 0xCBF29CE484222325;
+        for (uint64_t row : rows)
+        {
+            for (size_t i = 0; i < sizeof(row); i++)
+            {
+                hash ^= get_bits(row, i * 8, 8);
+                hash *= 0x100000001B3;
+            }
+        }
+        return hash;
+    }
+
+    [[nodiscard]] inline bool get_pixel(size_t x, size_t y) const
+    {
+        return (rows[y] >> (WIDTH - 1 - x)) & 1;
+    }
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "./Chip8.hpp"
+#include "./get_bits.hpp"
+
+// The implementation of every instruction, shared by the interpreter and the threaded engine
+// Control flow instructions set the program counter 2 bytes short of where execution continues,
+// since the program counter is incremented after every instruction
+template <Op op>
+inline void Chip8::execute_op(const DecodedInstruction &instruction)
+{
+    [[maybe_unused]] const uint8_t x = instruction.x;
+    [[maybe_unused]] const uint8_t y = instruction.y;
+    [[maybe_unused]] const uint8_t n = instruction.n;
+    [[maybe_unused]] const uint8_t kk = instruction.kk;
+    [[maybe_unused]] const addr_t nnn = instruction.nnn;
+
+    if constexpr (op == Op::CLS)
+    {
+        // 00E0 - CLS
+        std::unique_lock<std::mutex> lock = lock_framebuffer();
+        framebuffer.clear();
+    }
+    else if constexpr (op == Op::RET)
+    {
+        // 00EE - RET
+        stack_pointer = (stack_pointer - 1) & 0xF;
+        registers->pc_reg = stack[stack_pointer];
+    }
+    else if constexpr (op == Op::JP)
+    {
+        // 1nnn - JP addr
+        registers->pc_reg = nnn - 2;
+    }
+    else if constexpr (op == Op::CALL)
+    {
+        // 2nnn - CALL addr
+        stack[stack_pointer] = registers->pc_reg;
+        stack_pointer = (stack_pointer + 1) & 0xF;
+        registers->pc_reg = nnn - 2;
+    }
+    else if constexpr (op == Op::SE_BYTE)
+    {
+        // 3xkk - SE Vx, byte
+        if (registers->general_regs[x] == kk)
+            registers->pc_reg += 2;
+    }
+    else if constexpr (op == Op::SNE_BYTE)
+    {
+        // 4xkk - SNE Vx, byte
+        if (registers->general_regs[x] != kk)
+            registers->pc_reg += 2;
+    }
+    else if constexpr (op == Op::SE_REG)
+    {
+        // 5xy0 - SE Vx, Vy
+        if (registers->general_regs[x] == registers->general_regs[y])
+            registers->pc_reg += 2;
+    }
+    else if constexpr (op == Op::LD_BYTE)
+    {
+        // 6xkk - LD Vx, byte
+        registers->general_regs[x] = kk;
+    }
+    else if constexpr (op == Op::ADD_BYTE)
+    {
+        // 7xkk - ADD Vx, byte
+        registers->general_regs[x] += kk;
+    }
+    else if constexpr (op == Op::LD_REG)
+    {
+        // 8xy0 - LD Vx, Vy
+        registers->general_regs[x] = registers->general_regs[y];
+    }
+    else if constexpr (op == Op::OR)
+    {
+        // 8xy1 - OR Vx, Vy
+        registers->general_regs[x] |= registers->general_regs[y];
+    }
+    else if constexpr (op == Op::AND)
+    {
+        // 8xy2 - AND Vx, Vy
+        registers->general_regs[x] &= registers->general_regs[y];
+    }
+    else if constexpr (op == Op::XOR)
+    {
+        // 8xy3 - XOR Vx, Vy
+        registers->general_regs[x] ^= registers->general_regs[y];
+    }
+    else if constexpr (op == Op::ADD_REG)
+    {
+        // 8xy4 - ADD Vx, Vy
+        const uint16_t sum = static_cast<uint16_t>(registers->general_regs[x]) + static_cast<uint16_t>(registers->general_regs[y]);
+        registers->general_regs[0xF] = sum > 0xFF ? 1 : 0;
+        registers->general_regs[x] = sum;
+    }
+    else if constexpr (op == Op::SUB)
+    {
+        // 8xy5 - SUB Vx, Vy
+        registers->general_regs[0xF] = registers->general_regs[x] >= registers->general_regs[y] ? 1 : 0;
+        registers->general_regs[x] -= registers->general_regs[y];
+    }
+    else if constexpr (op == Op::SHR)
+    {
+        // 8xy6 - SHR Vx {, Vy}
+        registers->general_regs[0xF] = get_bits(registers->general_regs[y], 0, 1);
+        registers->general_regs[x] = registers->general_regs[y] >> 1;
+    }
+    else if constexpr (op == Op::SUBN)
+    {
+        // 8xy7 - SUBN Vx, Vy
+        registers->general_regs[0xF] = registers->general_regs[y] >= registers->general_regs[x] ? 1 : 0;
+        registers->general_regs[x] = registers->general_regs[y] - registers->general_regs[x];
+    }
+    else if constexpr (op == Op::SHL)
+    {
+        // 8xyE - SHL Vx {, Vy}
+        registers->general_regs[0xF] = get_bits(registers->general_regs[y], 7, 1);
+        registers->general_regs[x] = registers->general_regs[y] << 1;
+    }
+    else if constexpr (op == Op::SNE_REG)
+    {
+        // 9xy0 - SNE Vx, Vy
+        if (registers->general_regs[x] != registers->general_regs[y])
+            registers->pc_reg += 2;
+    }
+    else if constexpr (op == Op::LD_I)
+    {
+        // Annn - LD I, addr
+        registers->addr_reg = nnn;
+    }
+    else if constexpr (op == Op::JP_V0)
+    {
+        // Bnnn - JP V0, addr
+        registers->pc_reg = nnn + registers->general_regs[0] - 2;
+    }
+    else if constexpr (op == Op::RND)
+    {
+        // Cxkk - RND Vx, byte
+        registers->general_regs[x] = random.next_byte() & kk;
+    }
+    else if constexpr (op == Op::DRW)
+    {
+        // Dxyn - DRW Vx, Vy, nibble
+        registers->general_regs[0xF] = drawSprite(registers->addr_reg, registers->general_regs[x], registers->general_regs[y], n) ? 1 : 0;
+    }
+    else if constexpr (op == Op::SKP)
+    {
+        // Ex9E - SKP Vx
+        if (keypad->is_key_down(registers->general_regs[x]))
+            registers->pc_reg += 2;
+    }
+    else if constexpr (op == Op::SKNP)
+    {
+        // ExA1 - SKNP Vx
+        if (!keypad->is_key_down(registers->general_regs[x]))
+            registers->pc_reg += 2;
+    }
+    else if constexpr (op == Op::LD_VX_DT)
+    {
+        // Fx07 - LD Vx, DT
+        registers->general_regs[x] = registers->delay_reg;
+    }
+    else if constexpr (op == Op::LD_VX_K)
+    {
+        // Fx0A - LD Vx, K
+        // Without a key pressed right before this, start waiting and run this again once one is, the lowest key wins if there's more than one
+        const uint16_t presses = keypad->take_presses();
+        if (!presses)
+        {
+            state = CpuState::WaitingForKey;
+            registers->pc_reg -= 2;
+        }
+        else
+        {
+            uint8_t key = 0;
+            while (!get_bits(presses, key, 1))
+                key++;
+            registers->general_regs[x] = key;
+        }
+    }
+    else if constexpr (op == Op::LD_DT_VX)
+    {
+        // Fx15 - LD DT, Vx
+        registers->delay_reg = registers->general_regs[x];
+    }
+    else if constexpr (op == Op::LD_ST_VX)
+    {
+        // Fx18 - LD ST, Vx
+        registers->sound_reg = registers->general_regs[x];
+    }
+    else if constexpr (op == Op::ADD_I)
+    {
+        // Fx1E - ADD I, Vx
+        registers->addr_reg += registers->general_regs[x];
+    }
+    else if constexpr (op == Op::LD_F)
+    {
+        // Fx29 - LD F, Vx
+        registers->addr_reg = registers->general_regs[x] * 5;
+    }
+    else if constexpr (op == Op::LD_B)
+    {
+        // Fx33 - LD B, Vx
+        store(registers->addr_reg, registers->general_regs[x] / 100);
+        store(registers->addr_reg + 1, (registers->general_regs[x] / 10) % 10);
+        store(registers->addr_reg + 2, registers->general_regs[x] % 10);
+    }
+    else if constexpr (op == Op::LD_MEM_VX)
+    {
+        // Fx55 - LD [I], Vx
+        for (uint8_t idx = 0; idx <= x; idx++)
+            store(registers->addr_reg + idx, registers->general_regs[idx]);
+        registers->addr_reg += x + 1;
+    }
+    else if constexpr (op == Op::LD_VX_MEM)
+    {
+        // Fx65 - LD Vx, [I]
+        for (uint8_t idx = 0; idx <= x; idx++)
+            registers->general_regs[idx] = (*memory)[(registers->addr_reg + idx) & 0xFFF];
+        registers->addr_reg += x + 1;
+    }
+}
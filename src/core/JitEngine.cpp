@@ -0,0 +1,639 @@
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define CHIP8_JIT_SUPPORTED 1
+#endif
+
+#include "./JitEngine.hpp"
+#include "./Chip8.hpp"
+#include "./get_bits.hpp"
+
+// Writes x86-64 instructions into a buffer
+// Only the handful of 32 bit register forms the compiler needs are supported
+// Registers are numbered the way x86-64 encodes them, 0 is eax and 8 to 15 are r8d to r15d
+class JitEngine::Emitter
+{
+public:
+    enum Reg : uint8_t
+    {
+        EAX = 0,
+        ECX = 1,
+        EDX = 2,
+        ESI = 6,
+        EDI = 7,
+        R8D = 8,
+        R9D = 9,
+        R10D = 10,
+        R11D = 11,
+    };
+
+    // The /digit of the 0x81 group and the opcode of the register to register form for each ALU operation
+    enum class Alu : uint8_t
+    {
+        ADD = 0,
+        OR = 1,
+        AND = 4,
+        SUB = 5,
+        XOR = 6,
+        CMP = 7,
+    };
+
+    enum class Condition : uint8_t
+    {
+        E = 0x4,
+        NE = 0x5,
+    };
+
+    std::vector<uint8_t> code;
+
+    // reg, [rdi + offset] or reg, rm
+    void rex(bool wide, uint8_t reg, uint8_t rm, bool force = false)
+    {
+        const uint8_t prefix = 0x40 | (wide << 3) | (get_bits(reg, 3, 1) << 2) | get_bits(rm, 3, 1);
+        if (prefix != 0x40 || force)
+            code.push_back(prefix);
+    }
+
+    void modrm_reg(uint8_t reg, uint8_t rm)
+    {
+        code.push_back(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    // [rdi + offset], the only memory operand blocks use
+    void modrm_mem(uint8_t reg, uint8_t offset)
+    {
+        code.push_back(0x40 | ((reg & 7) << 3) | EDI);
+        code.push_back(offset);
+    }
+
+    void imm32(uint32_t value)
+    {
+        for (size_t idx = 0; idx < 4; idx++)
+            code.push_back(get_bits(value, idx * 8, 8));
+    }
+
+    // dst = value
+    void mov_imm(uint8_t dst, uint32_t value)
+    {
+        rex(false, 0, dst);
+        code.push_back(0xB8 | (dst & 7));
+        imm32(value);
+    }
+
+    // dst = src
+    void mov(uint8_t dst, uint8_t src)
+    {
+        if (dst == src)
+            return;
+        rex(false, src, dst);
+        code.push_back(0x89);
+        modrm_reg(src, dst);
+    }
+
+    // dst op= src
+    void alu(Alu op, uint8_t dst, uint8_t src)
+    {
+        static constexpr const uint8_t OPCODES[] = {0x01, 0x09, 0, 0, 0x21, 0x29, 0x31, 0x39};
+        rex(false, src, dst);
+        code.push_back(OPCODES[static_cast<uint8_t>(op)]);
+        modrm_reg(src, dst);
+    }
+
+    // dst op= value
+    void alu_imm(Alu op, uint8_t dst, uint32_t value)
+    {
+        rex(false, 0, dst);
+        code.push_back(0x81);
+        modrm_reg(static_cast<uint8_t>(op), dst);
+        imm32(value);
+    }
+
+    void shr(uint8_t dst, uint8_t amount)
+    {
+        rex(false, 0, dst);
+        code.push_back(0xC1);
+        modrm_reg(5, dst);
+        code.push_back(amount);
+    }
+
+    void shl(uint8_t dst, uint8_t amount)
+    {
+        rex(false, 0, dst);
+        code.push_back(0xC1);
+        modrm_reg(4, dst);
+        code.push_back(amount);
+    }
+
+    // dst = src * value
+    void imul_imm(uint8_t dst, uint8_t src, uint8_t value)
+    {
+        rex(false, dst, src);
+        code.push_back(0x6B);
+        modrm_reg(dst, src);
+        code.push_back(value);
+    }
+
+    // if (condition) dst = src
+    void cmov(Condition condition, uint8_t dst, uint8_t src)
+    {
+        rex(false, dst, src);
+        code.push_back(0x0F);
+        code.push_back(0x40 | static_cast<uint8_t>(condition));
+        modrm_reg(dst, src);
+    }
+
+    // dst = zero extended byte [rdi + offset]
+    void load_byte(uint8_t dst, uint8_t offset)
+    {
+        rex(false, dst, EDI);
+        code.push_back(0x0F);
+        code.push_back(0xB6);
+        modrm_mem(dst, offset);
+    }
+
+    // dst = zero extended word [rdi + offset]
+    void load_word(uint8_t dst, uint8_t offset)
+    {
+        rex(false, dst, EDI);
+        code.push_back(0x0F);
+        code.push_back(0xB7);
+        modrm_mem(dst, offset);
+    }
+
+    // byte [rdi + offset] = low byte of src
+    void store_byte(uint8_t offset, uint8_t src)
+    {
+        // Without a REX prefix, 4 to 7 would be ah, ch, dh and bh instead of spl, bpl, sil and dil
+        rex(false, src, EDI, src >= 4);
+        code.push_back(0x88);
+        modrm_mem(src, offset);
+    }
+
+    // word [rdi + offset] = low word of src
+    void store_word(uint8_t offset, uint8_t src)
+    {
+        code.push_back(0x66);
+        rex(false, src, EDI);
+        code.push_back(0x89);
+        modrm_mem(src, offset);
+    }
+
+    // word [rdi + offset] = value
+    void store_word_imm(uint8_t offset, uint16_t value)
+    {
+        code.push_back(0x66);
+        code.push_back(0xC7);
+        modrm_mem(0, offset);
+        code.push_back(get_bits(value, 0, 8));
+        code.push_back(get_bits(value, 8, 8));
+    }
+
+    void ret()
+    {
+        code.push_back(0xC3);
+    }
+};
+
+JitEngine::JitEngine(Chip8 &chip8) : chip8(chip8)
+{
+#ifdef CHIP8_JIT_SUPPORTED
+    // The buffer is never writable and executable at once, code is written with its pages made writable and then executable again
+    // Hosts that don't allow making it executable at all, like SELinux denying execmem, are left without the JIT
+    void *buffer = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED)
+        return;
+    if (mprotect(buffer, CODE_BUFFER_SIZE, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(buffer, CODE_BUFFER_SIZE);
+        return;
+    }
+    code_buffer = static_cast<uint8_t *>(buffer);
+#endif
+}
+
+JitEngine::~JitEngine()
+{
+#ifdef CHIP8_JIT_SUPPORTED
+    if (code_buffer)
+        munmap(code_buffer, CODE_BUFFER_SIZE);
+#endif
+}
+
+void JitEngine::compile(addr_t pc)
+{
+    // The host registers general registers can be kept in
+    // r10d is used for scratch and r11d holds I, or is a second scratch register once I is written back
+    static constexpr const std::array<uint8_t, 6> HOST_REGS{Emitter::EAX, Emitter::ECX, Emitter::EDX, Emitter::ESI, Emitter::R8D, Emitter::R9D};
+    static constexpr const uint8_t SCRATCH = Emitter::R10D;
+    static constexpr const uint8_t ADDR = Emitter::R11D;
+    static constexpr const uint8_t UNMAPPED = 0xFF;
+
+    static constexpr const uint8_t GENERAL_OFFSET = offsetof(Registers, general_regs);
+    static constexpr const uint8_t ADDR_OFFSET = offsetof(Registers, addr_reg);
+    static constexpr const uint8_t DELAY_OFFSET = offsetof(Registers, delay_reg);
+    static constexpr const uint8_t SOUND_OFFSET = offsetof(Registers, sound_reg);
+    static constexpr const uint8_t PC_OFFSET = offsetof(Registers, pc_reg);
+
+    Block &block = blocks[pc];
+
+    // Pick the instructions in the block and which host register each general register lives in
+    std::vector<DecodedInstruction> instructions;
+    std::array<uint8_t, 0x10> host{};
+    host.fill(UNMAPPED);
+    size_t mapped = 0;
+    bool uses_addr = false;
+    bool terminated = false;
+    bool done = false;
+
+    addr_t addr = pc;
+    while (instructions.size() < MAX_BLOCK_LENGTH && !done)
+    {
+        if (get_bits(written_pages, (addr & 0xFFF) >> 8, 1) || get_bits(written_pages, ((addr + 1) & 0xFFF) >> 8, 1))
+            break;
+
+        const DecodedInstruction instruction = decode(chip8.fetch(addr));
+
+        // The general registers the instruction touches
+        std::array<uint8_t, 3> regs{instruction.x, UNMAPPED, UNMAPPED};
+        switch (instruction.op)
+        {
+        case Op::LD_BYTE:
+        case Op::ADD_BYTE:
+        case Op::SE_BYTE:
+        case Op::SNE_BYTE:
+        case Op::LD_VX_DT:
+        case Op::LD_DT_VX:
+        case Op::LD_ST_VX:
+            break;
+        case Op::LD_REG:
+        case Op::OR:
+        case Op::AND:
+        case Op::XOR:
+        case Op::SE_REG:
+        case Op::SNE_REG:
+            regs[1] = instruction.y;
+            break;
+        case Op::ADD_REG:
+        case Op::SUB:
+        case Op::SHR:
+        case Op::SUBN:
+        case Op::SHL:
+            regs[1] = instruction.y;
+            regs[2] = 0xF;
+            break;
+        case Op::LD_I:
+            regs[0] = UNMAPPED;
+            uses_addr = true;
+            break;
+        case Op::ADD_I:
+        case Op::LD_F:
+            uses_addr = true;
+            break;
+        case Op::JP:
+            regs[0] = UNMAPPED;
+            break;
+        default:
+            // Everything else is left to the interpreter
+            done = true;
+            continue;
+        }
+
+        // End the block early when the instruction needs more general registers than there are host registers left
+        size_t needed = 0;
+        for (size_t idx = 0; idx < regs.size(); idx++)
+        {
+            if (regs[idx] != UNMAPPED && host[regs[idx]] == UNMAPPED && std::find(regs.begin(), regs.begin() + idx, regs[idx]) == regs.begin() + idx)
+                needed++;
+        }
+        if (mapped + needed > HOST_REGS.size())
+            break;
+
+        for (uint8_t reg : regs)
+        {
+            if (reg != UNMAPPED && host[reg] == UNMAPPED)
+                host[reg] = HOST_REGS[mapped++];
+        }
+
+        instructions.push_back(instruction);
+        addr += 2;
+
+        switch (instruction.op)
+        {
+        case Op::JP:
+        case Op::SE_BYTE:
+        case Op::SNE_BYTE:
+        case Op::SE_REG:
+        case Op::SNE_REG:
+            terminated = done = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (instructions.empty())
+    {
+        block.uncompilable = true;
+        return;
+    }
+
+    Emitter emitter;
+
+    // Load the registers the block uses
+    for (uint8_t reg = 0; reg < host.size(); reg++)
+    {
+        if (host[reg] != UNMAPPED)
+            emitter.load_byte(host[reg], GENERAL_OFFSET + reg);
+    }
+    if (uses_addr)
+        emitter.load_word(ADDR, ADDR_OFFSET);
+
+    std::bitset<0x10> dirty;
+    bool addr_dirty = false;
+
+    // Straight line instructions, every host register holding a general register always stays within 0 to 0xFF
+    const size_t straight_line = terminated ? instructions.size() - 1 : instructions.size();
+    for (size_t idx = 0; idx < straight_line; idx++)
+    {
+        const DecodedInstruction &instruction = instructions[idx];
+        const uint8_t vx = host[instruction.x];
+        const uint8_t vy = host[instruction.y];
+        const uint8_t vf = host[0xF];
+
+        switch (instruction.op)
+        {
+        case Op::LD_BYTE:
+            // 6xkk - LD Vx, byte
+            emitter.mov_imm(vx, instruction.kk);
+            dirty[instruction.x] = true;
+            break;
+        case Op::ADD_BYTE:
+            // 7xkk - ADD Vx, byte
+            emitter.alu_imm(Emitter::Alu::ADD, vx, instruction.kk);
+            emitter.alu_imm(Emitter::Alu::AND, vx, 0xFF);
+            dirty[instruction.x] = true;
+            break;
+        case Op::LD_REG:
+            // 8xy0 - LD Vx, Vy
+            emitter.mov(vx, vy);
+            dirty[instruction.x] = true;
+            break;
+        case Op::OR:
+            // 8xy1 - OR Vx, Vy
+            emitter.alu(Emitter::Alu::OR, vx, vy);
+            dirty[instruction.x] = true;
+            break;
+        case Op::AND:
+            // 8xy2 - AND Vx, Vy
+            emitter.alu(Emitter::Alu::AND, vx, vy);
+            dirty[instruction.x] = true;
+            break;
+        case Op::XOR:
+            // 8xy3 - XOR Vx, Vy
+            emitter.alu(Emitter::Alu::XOR, vx, vy);
+            dirty[instruction.x] = true;
+            break;
+        case Op::ADD_REG:
+            // 8xy4 - ADD Vx, Vy
+            // VF is set before Vx, exactly like the interpreter, so the results match when x or y is F
+            emitter.mov(SCRATCH, vx);
+            emitter.alu(Emitter::Alu::ADD, SCRATCH, vy);
+            emitter.mov(vf, SCRATCH);
+            emitter.shr(vf, 8);
+            emitter.mov(vx, SCRATCH);
+            emitter.alu_imm(Emitter::Alu::AND, vx, 0xFF);
+            dirty[instruction.x] = dirty[0xF] = true;
+            break;
+        case Op::SUB:
+            // 8xy5 - SUB Vx, Vy
+            // Bit 8 of the 32 bit difference is set when it borrowed
+            emitter.mov(SCRATCH, vx);
+            emitter.alu(Emitter::Alu::SUB, SCRATCH, vy);
+            emitter.shr(SCRATCH, 8);
+            emitter.alu_imm(Emitter::Alu::AND, SCRATCH, 1);
+            emitter.alu_imm(Emitter::Alu::XOR, SCRATCH, 1);
+            emitter.mov(vf, SCRATCH);
+            emitter.alu(Emitter::Alu::SUB, vx, vy);
+            emitter.alu_imm(Emitter::Alu::AND, vx, 0xFF);
+            dirty[instruction.x] = dirty[0xF] = true;
+            break;
+        case Op::SHR:
+            // 8xy6 - SHR Vx {, Vy}
+            emitter.mov(SCRATCH, vy);
+            emitter.alu_imm(Emitter::Alu::AND, SCRATCH, 1);
+            emitter.mov(vf, SCRATCH);
+            emitter.mov(SCRATCH, vy);
+            emitter.shr(SCRATCH, 1);
+            emitter.mov(vx, SCRATCH);
+            dirty[instruction.x] = dirty[0xF] = true;
+            break;
+        case Op::SUBN:
+            // 8xy7 - SUBN Vx, Vy
+            emitter.mov(SCRATCH, vy);
+            emitter.alu(Emitter::Alu::SUB, SCRATCH, vx);
+            emitter.shr(SCRATCH, 8);
+            emitter.alu_imm(Emitter::Alu::AND, SCRATCH, 1);
+            emitter.alu_imm(Emitter::Alu::XOR, SCRATCH, 1);
+            emitter.mov(vf, SCRATCH);
+            emitter.mov(SCRATCH, vy);
+            emitter.alu(Emitter::Alu::SUB, SCRATCH, vx);
+            emitter.alu_imm(Emitter::Alu::AND, SCRATCH, 0xFF);
+            emitter.mov(vx, SCRATCH);
+            dirty[instruction.x] = dirty[0xF] = true;
+            break;
+        case Op::SHL:
+            // 8xyE - SHL Vx {, Vy}
+            emitter.mov(SCRATCH, vy);
+            emitter.shr(SCRATCH, 7);
+            emitter.mov(vf, SCRATCH);
+            emitter.mov(SCRATCH, vy);
+            emitter.shl(SCRATCH, 1);
+            emitter.alu_imm(Emitter::Alu::AND, SCRATCH, 0xFF);
+            emitter.mov(vx, SCRATCH);
+            dirty[instruction.x] = dirty[0xF] = true;
+            break;
+        case Op::LD_I:
+            // Annn - LD I, addr
+            emitter.mov_imm(ADDR, instruction.nnn);
+            addr_dirty = true;
+            break;
+        case Op::LD_VX_DT:
+            // Fx07 - LD Vx, DT
+            emitter.load_byte(vx, DELAY_OFFSET);
+            dirty[instruction.x] = true;
+            break;
+        case Op::LD_DT_VX:
+            // Fx15 - LD DT, Vx
+            emitter.store_byte(DELAY_OFFSET, vx);
+            break;
+        case Op::LD_ST_VX:
+            // Fx18 - LD ST, Vx
+            emitter.store_byte(SOUND_OFFSET, vx);
+            break;
+        case Op::ADD_I:
+            // Fx1E - ADD I, Vx
+            emitter.alu(Emitter::Alu::ADD, ADDR, vx);
+            emitter.alu_imm(Emitter::Alu::AND, ADDR, 0xFFFF);
+            addr_dirty = true;
+            break;
+        case Op::LD_F:
+            // Fx29 - LD F, Vx
+            emitter.imul_imm(ADDR, vx, 5);
+            addr_dirty = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Write back everything the block changed
+    for (uint8_t reg = 0; reg < host.size(); reg++)
+    {
+        if (dirty[reg])
+            emitter.store_byte(GENERAL_OFFSET + reg, host[reg]);
+    }
+    if (addr_dirty)
+        emitter.store_word(ADDR_OFFSET, ADDR);
+
+    // Set the program counter
+    const addr_t last = addr - 2;
+    if (!terminated)
+    {
+        emitter.store_word_imm(PC_OFFSET, addr & 0xFFF);
+    }
+    else if (instructions.back().op == Op::JP)
+    {
+        // 1nnn - JP addr
+        emitter.store_word_imm(PC_OFFSET, instructions.back().nnn);
+    }
+    else
+    {
+        // The skips compare, then pick between the next instruction and the one after it
+        const DecodedInstruction &instruction = instructions.back();
+        if (instruction.op == Op::SE_BYTE || instruction.op == Op::SNE_BYTE)
+            emitter.alu_imm(Emitter::Alu::CMP, host[instruction.x], instruction.kk);
+        else
+            emitter.alu(Emitter::Alu::CMP, host[instruction.x], host[instruction.y]);
+
+        emitter.mov_imm(SCRATCH, static_cast<addr_t>((last + 2) & 0xFFF));
+        emitter.mov_imm(ADDR, static_cast<addr_t>((last + 4) & 0xFFF));
+        emitter.cmov(instruction.op == Op::SE_BYTE || instruction.op == Op::SE_REG ? Emitter::Condition::E : Emitter::Condition::NE, SCRATCH, ADDR);
+        emitter.store_word(PC_OFFSET, SCRATCH);
+    }
+
+    emitter.ret();
+
+    // Start over with an empty buffer when it fills up
+    if (code_used + emitter.code.size() > CODE_BUFFER_SIZE)
+    {
+        for (Block &compiled : blocks)
+        {
+            compiled.code = nullptr;
+            compiled.hits = 0;
+        }
+        compiled_pages = 0;
+        code_used = 0;
+    }
+
+    // Blocks sharing a host page with this one might not be executable anymore, so they're all dropped
+    if (!write_code(code_used, emitter.code))
+    {
+        for (Block &compiled : blocks)
+            compiled.code = nullptr;
+        compiled_pages = 0;
+        block.uncompilable = true;
+        return;
+    }
+    block.code = reinterpret_cast<BlockFunction>(code_buffer + code_used);
+    block.instructions = instructions.size();
+    block.end = addr;
+    code_used += emitter.code.size();
+
+    for (addr_t byte_addr = pc; byte_addr != addr; byte_addr++)
+    {
+        chip8.translated_code[byte_addr & 0xFFF] = true;
+        compiled_pages |= 1 << ((byte_addr & 0xFFF) >> 8);
+    }
+}
+
+uint32_t JitEngine::run(uint32_t count)
+{
+    Registers *registers = chip8.registers.get();
+
+    uint32_t executed = 0;
+    while (executed < count)
+    {
+        const addr_t pc = registers->pc_reg & 0xFFF;
+        Block &block = blocks[pc];
+
+        if (!block.code && !block.uncompilable && ++block.hits >= HOT_THRESHOLD)
+            compile(pc);
+
+        // Only run the block when all of it fits, so a run always executes exactly count instructions
+        if (block.code && block.instructions <= count - executed)
+        {
+            block.code(registers);
+            executed += block.instructions;
+            continue;
+        }
+
+        if (chip8.at_key_wait())
+            break;
+
+        chip8.step();
+        executed++;
+        if (chip8.halted())
+            break;
+    }
+
+    return executed;
+}
+
+void JitEngine::invalidate(addr_t addr)
+{
+    // Code in the page is left to the interpreter from now on
+    const size_t page = (addr & 0xFFF) >> 8;
+    written_pages |= 1 << page;
+    if (!get_bits(compiled_pages, page, 1))
+        return;
+    compiled_pages &= ~(1 << page);
+
+    const addr_t page_start = page << 8;
+    for (addr_t start = 0; start < blocks.size(); start++)
+    {
+        Block &block = blocks[start];
+        const addr_t length = (block.end - start) & 0xFFF;
+        if (block.code && (((page_start - start) & 0xFFF) < length || ((start - page_start) & 0xFFF) < 0x100))
+            block.code = nullptr;
+    }
+}
+
+bool JitEngine::write_code(size_t offset, const std::vector<uint8_t> &code)
+{
+#ifdef CHIP8_JIT_SUPPORTED
+    // Only the host pages the code lands on are made writable, and only while it's copied in
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t first = offset / page_size * page_size;
+    const size_t length = offset + code.size() - first;
+    if (mprotect(code_buffer + first, length, PROT_READ | PROT_WRITE) != 0)
+        return false;
+    std::memcpy(code_buffer + offset, code.data(), code.size());
+    return mprotect(code_buffer + first, length, PROT_READ | PROT_EXEC) == 0;
+#else
+    return false;
+#endif
+}
+
+void JitEngine::clear()
+{
+    blocks.fill(Block());
+    written_pages = 0;
+    compiled_pages = 0;
+    code_used = 0;
+}
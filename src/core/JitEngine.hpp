@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./Decoder.hpp"
+#include "./Registers.hpp"
+#include "./types.hpp"
+
+class Chip8;
+
+// Runs the Chip 8 by compiling hot basic blocks to x86-64 machine code
+// Compiled blocks keep the general registers and I in host registers and only write them back when the block ends
+// Anything that can't be compiled, and any page of memory that's been written to, is left to the interpreter
+class JitEngine
+{
+public:
+    // The number of times a block has to be reached before it's compiled
+    static constexpr const uint8_t HOT_THRESHOLD = 8;
+    static constexpr const size_t MAX_BLOCK_LENGTH = 64;
+    static constexpr const size_t CODE_BUFFER_SIZE = 1 << 20;
+
+private:
+    class Emitter;
+
+    typedef void (*BlockFunction)(Registers *registers);
+
+    struct Block
+    {
+        BlockFunction code = nullptr;
+        // The number of instructions the block executes
+        uint16_t instructions = 0;
+        // The address after the last byte the block was compiled from
+        addr_t end = 0;
+        // The number of times the block has been reached without being compiled
+        uint8_t hits = 0;
+        // Set when the first instruction can't be compiled
+        bool uncompilable = false;
+    };
+
+    Chip8 &chip8;
+
+    // Compiled blocks by their starting address
+    std::array<Block, 0x1000> blocks{};
+
+    // A bit for each 256 byte page of memory that's been written to since the program was loaded
+    uint16_t written_pages = 0;
+
+    // A bit for each page compiled blocks were compiled from, so writes to other pages don't have to look for blocks
+    uint16_t compiled_pages = 0;
+
+    // Executable memory the blocks are compiled into, it's only writable while write_code copies a block in
+    uint8_t *code_buffer = nullptr;
+    size_t code_used = 0;
+
+    void compile(addr_t pc);
+
+    // Copy machine code into the buffer at the offset, returns false if the buffer couldn't be made writable or executable again
+    bool write_code(size_t offset, const std::vector<uint8_t> &code);
+
+public:
+    JitEngine(Chip8 &chip8);
+    ~JitEngine();
+
+    // Whether machine code can be generated and run on this host
+    [[nodiscard]] bool available() const
+    {
+        return code_buffer != nullptr;
+    }
+
+    // Execute up to count instructions, stopping early before an instruction that waits for a key
+    // Returns the number of instructions executed
+    uint32_t run(uint32_t count);
+
+    // Called when memory that's part of a compiled block is written to
+    void invalidate(addr_t addr);
+
+    // Throw away every compiled block
+    void clear();
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// A key being pressed or released, stamped with the instruction count it takes effect at
+struct KeyEvent
+{
+    uint64_t cycle = 0;
+    uint8_t key = 0;
+    bool down = false;
+};
+
+// The state of the 16 keys on the Chip 8 keypad
+// Input comes in as events from a single producer, like the window thread, through a lock-free ring buffer
+// The Chip 8 is the single consumer, applying events between instructions so it always sees the keys change at the same point
+// Live releases are never lost to a full queue, otherwise a key would stay down after a stall like a breakpoint until it was pressed again
+class KeypadState
+{
+public:
+    // Events past this many waiting to be applied are dropped, except for live releases
+    static constexpr const size_t EVENT_CAPACITY = 64;
+
+private:
+    // A bit for each key that's down, written only by the consumer
+    std::atomic<uint16_t> keys{0};
+
+    // A bit for each key pressed at the instruction count events were last applied at, only used by the consumer
+    uint16_t presses = 0;
+
+    // The ring buffer of events, head is only written by the consumer and tail only by the producer
+    // Both only ever increase, the slot is the index modulo the capacity
+    std::array<KeyEvent, EVENT_CAPACITY> events{};
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+    // The consumer's instruction count as of the last time it applied events, used to stamp events from the producer
+    alignas(64) std::atomic<uint64_t> published_cycle{0};
+
+    // A bit for each key whose live release didn't fit in the queue, set by the producer and taken by the consumer
+    // Each is applied once the queue has been read up to where it would have gone, before anything queued after it
+    // Whoever clears a bit owns the release, the consumer to apply it or the producer to queue it ahead of a press of the same key
+    std::atomic<uint16_t> dropped_releases{0};
+
+    // Where in the queue each dropped release would have gone, written by the producer before it sets the key's bit
+    std::array<std::atomic<size_t>, 0x10> dropped_at{};
+
+    // When set, every event is added to it stamped with the instruction count it was actually applied at, only used by the consumer
+    std::vector<KeyEvent> *recording = nullptr;
+
+    // Release the keys whose releases were dropped at or before the queue position, returning the new key state
+    // Only called by the consumer
+    uint16_t apply_dropped_releases(size_t read, uint16_t state, uint64_t cycle)
+    {
+        const uint16_t dropped = dropped_releases.load(std::memory_order_acquire);
+        for (uint8_t key = 0; key < 0x10; key++)
+        {
+            const uint16_t bit = 1 << key;
+            if (!(dropped & bit) || dropped_at[key].load(std::memory_order_relaxed) > read)
+                continue;
+
+            // The producer took it back to queue it itself
+            if (!(dropped_releases.fetch_and(~bit, std::memory_order_acq_rel) & bit))
+                continue;
+
+            state &= ~bit;
+            if (recording)
+                recording->push_back({cycle, key, false});
+        }
+        return state;
+    }
+
+public:
+    // Queue a key being pressed or released, taking effect at the given instruction count
+    // Events have to be queued in the order they take effect
+    // Only call this from the producer, returns false if the queue is full
+    bool push(uint8_t key, bool down, uint64_t cycle)
+    {
+        const size_t write = tail.load(std::memory_order_relaxed);
+        if (write - head.load(std::memory_order_acquire) == EVENT_CAPACITY)
+            return false;
+
+        events[write % EVENT_CAPACITY] = {cycle, static_cast<uint8_t>(key & 0xF), down};
+        tail.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Queue a key being pressed or released as soon as the consumer next applies events
+    // Only call this from the producer, returns false if a press was dropped because the queue is full, releases are always kept
+    bool push(uint8_t key, bool down)
+    {
+        const uint16_t bit = 1 << (key & 0xF);
+        const uint64_t cycle = published_cycle.load(std::memory_order_relaxed);
+
+        if (!down)
+        {
+            if (!push(key, false, cycle))
+            {
+                dropped_at[key & 0xF].store(tail.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                dropped_releases.fetch_or(bit, std::memory_order_release);
+            }
+            return true;
+        }
+
+        // Take back a release of the key that didn't fit, unless the consumer already has, so it's queued ahead of the press
+        if ((dropped_releases.load(std::memory_order_relaxed) & bit) && (dropped_releases.fetch_and(~bit, std::memory_order_acq_rel) & bit))
+        {
+            // Still no room for both, the release stays where it was dropped
+            if (EVENT_CAPACITY - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire)) < 2)
+            {
+                dropped_releases.fetch_or(bit, std::memory_order_release);
+                return false;
+            }
+            push(key, false, cycle);
+        }
+        return push(key, true, cycle);
+    }
+
+    // The instruction count the next event takes effect at, if there is one
+    // Only call this from the consumer
+    [[nodiscard]] std::optional<uint64_t> next_event_cycle() const
+    {
+        const size_t read = head.load(std::memory_order_relaxed);
+        if (read == tail.load(std::memory_order_acquire))
+            return std::nullopt;
+        return events[read % EVENT_CAPACITY].cycle;
+    }
+
+    // Apply every event that takes effect at or before the instruction count
+    // Only call this from the consumer
+    void apply_events(uint64_t cycle)
+    {
+        // Presses only count for the instruction they happened before
+        if (cycle != published_cycle.load(std::memory_order_relaxed))
+            presses = 0;
+        published_cycle.store(cycle, std::memory_order_relaxed);
+
+        size_t read = head.load(std::memory_order_relaxed);
+        const size_t write = tail.load(std::memory_order_acquire);
+        if (read == write && !dropped_releases.load(std::memory_order_relaxed))
+            return;
+
+        uint16_t state = keys.load(std::memory_order_relaxed);
+        for (;; read++)
+        {
+            // Dropped releases go before the event that was queued where they would have been
+            if (dropped_releases.load(std::memory_order_relaxed))
+                state = apply_dropped_releases(read, state, cycle);
+
+            if (read == write || events[read % EVENT_CAPACITY].cycle > cycle)
+                break;
+
+            const KeyEvent &event = events[read % EVENT_CAPACITY];
+            if (recording)
+                recording->push_back({cycle, event.key, event.down});
+            if (event.down)
+            {
+                state |= 1 << event.key;
+                presses |= 1 << event.key;
+            }
+            else
+            {
+                state &= ~(1 << event.key);
+            }
+        }
+
+        keys.store(state, std::memory_order_relaxed);
+        head.store(read, std::memory_order_release);
+    }
+
+    // Whether any key was pressed right before the current instruction
+    // Only call this from the consumer
+    [[nodiscard]] bool has_presses() const
+    {
+        return presses != 0;
+    }
+
+    // Get the keys pressed right before the current instruction and forget them
+    // Only call this from the consumer
+    uint16_t take_presses()
+    {
+        const uint16_t taken = presses;
+        presses = 0;
+        return taken;
+    }
+
+    // Move to an earlier instruction count, like when restoring a save state
+    // Events queued for later than it were queued before going back, so they're applied right away instead
+    // Only call this from the consumer
+    void rebase(uint64_t cycle)
+    {
+        const size_t write = tail.load(std::memory_order_acquire);
+        for (size_t read = head.load(std::memory_order_relaxed); read != write; read++)
+            events[read % EVENT_CAPACITY].cycle = std::min(events[read % EVENT_CAPACITY].cycle, cycle);
+
+        // Recorded events from after the point gone back to never happened anymore
+        if (recording)
+            recording->erase(std::find_if(recording->begin(), recording->end(), [cycle](const KeyEvent &event)
+                                          { return event.cycle >= cycle; }),
+                             recording->end());
+
+        presses = 0;
+        published_cycle.store(cycle, std::memory_order_relaxed);
+    }
+
+    // Record every event applied from now on, or stop recording with nullptr
+    // Only call this while the consumer isn't running
+    void record(std::vector<KeyEvent> *recording)
+    {
+        this->recording = recording;
+    }
+
+    // Replace the keys that are down, like when restoring a save state
+    // Only call this from the consumer
+    void set_keys(uint16_t keys)
+    {
+        this->keys.store(keys, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] inline bool is_key_down(uint8_t key) const
+    {
+        return keys.load(std::memory_order_relaxed) >> (key & 0xF) & 1;
+    }
+
+    // A bit for each key that's down
+    [[nodiscard]] uint16_t get_keys() const
+    {
+        return keys.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "./types.hpp"
+
+// A counter for each 256 byte page of memory, bumped whenever the page is written to
+// Anything made from memory, like disassembly, can remember the generation it was made at and tell when it's stale without looking at the bytes
+class MemoryGenerations
+{
+public:
+    static constexpr const addr_t PAGE_SIZE = 0x100;
+    static constexpr const size_t PAGES = 0x1000 / PAGE_SIZE;
+
+private:
+    std::array<std::atomic<uint32_t>, PAGES> pages{};
+
+public:
+    // Called after the memory is written, so a reader that sees the new generation sees the new bytes too
+    inline void written(addr_t addr)
+    {
+        pages[(addr & 0xFFF) / PAGE_SIZE].fetch_add(1, std::memory_order_release);
+    }
+
+    void written_all()
+    {
+        for (std::atomic<uint32_t> &page : pages)
+            page.fetch_add(1, std::memory_order_release);
+    }
+
+    [[nodiscard]] inline uint32_t get(addr_t addr) const
+    {
+        return pages[(addr & 0xFFF) / PAGE_SIZE].load(std::memory_order_acquire);
+    }
+};
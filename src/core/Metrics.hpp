@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Counters for how fast the emulator is running, added to by the threads doing the work and readable from any thread
+// Everything counts up from zero, and rates come from the difference between two samples
+// The Chip 8 counts instructions, timer ticks and framebuffer waits on its own, so headless runs get those for free
+// The window counts its own frames and drawing
+struct Metrics
+{
+    using Counter = std::atomic<uint64_t>;
+
+    Counter instructions{0};
+    Counter timer_ticks{0};
+
+    // Times the framebuffer's mutex was already held when a thread wanted it, and how long they waited in total
+    Counter framebuffer_waits{0};
+    Counter framebuffer_wait_ns{0};
+
+    Counter window_frames{0};
+    Counter window_frame_ns{0};
+    // Time spent putting the Chip 8's display on the window
+    Counter draw_ns{0};
+    Counter draw_calls{0};
+
+    // Every counter at one moment
+    struct Sample
+    {
+        std::chrono::steady_clock::time_point time;
+        uint64_t instructions;
+        uint64_t timer_ticks;
+        uint64_t framebuffer_waits;
+        uint64_t framebuffer_wait_ns;
+        uint64_t window_frames;
+        uint64_t window_frame_ns;
+        uint64_t draw_ns;
+        uint64_t draw_calls;
+    };
+
+    // What happened between two samples
+    struct Rates
+    {
+        double instructions_per_second = 0;
+        double timer_ticks_per_second = 0;
+        double framebuffer_waits_per_second = 0;
+        // Milliseconds spent waiting for the framebuffer every second
+        double framebuffer_wait_ms = 0;
+        double window_frames_per_second = 0;
+        double frame_ms = 0;
+        double draw_ms = 0;
+        double draw_calls_per_frame = 0;
+    };
+
+    static inline void add(Counter &counter, uint64_t amount)
+    {
+        counter.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] Sample sample() const
+    {
+        return {
+            std::chrono::steady_clock::now(),
+            instructions.load(std::memory_order_relaxed),
+            timer_ticks.load(std::memory_order_relaxed),
+            framebuffer_waits.load(std::memory_order_relaxed),
+            framebuffer_wait_ns.load(std::memory_order_relaxed),
+            window_frames.load(std::memory_order_relaxed),
+            window_frame_ns.load(std::memory_order_relaxed),
+            draw_ns.load(std::memory_order_relaxed),
+            draw_calls.load(std::memory_order_relaxed),
+        };
+    }
+
+    [[nodiscard]] static Rates rates(const Sample &before, const Sample &after)
+    {
+        Rates rates;
+        const double seconds = std::chrono::duration<double>(after.time - before.time).count();
+        if (seconds <= 0)
+            return rates;
+
+        rates.instructions_per_second = (after.instructions - before.instructions) / seconds;
+        rates.timer_ticks_per_second = (after.timer_ticks - before.timer_ticks) / seconds;
+        rates.framebuffer_waits_per_second = (after.framebuffer_waits - before.framebuffer_waits) / seconds;
+        rates.framebuffer_wait_ms = (after.framebuffer_wait_ns - before.framebuffer_wait_ns) / 1e6 / seconds;
+        rates.window_frames_per_second = (after.window_frames - before.window_frames) / seconds;
+
+        if (const uint64_t frames = after.window_frames - before.window_frames)
+        {
+            rates.frame_ms = (after.window_frame_ns - before.window_frame_ns) / 1e6 / frames;
+            rates.draw_ms = (after.draw_ns - before.draw_ns) / 1e6 / frames;
+            rates.draw_calls_per_frame = static_cast<double>(after.draw_calls - before.draw_calls) / frames;
+        }
+        return rates;
+    }
+};
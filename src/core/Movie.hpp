@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./Chip8.hpp"
+#include "./KeypadState.hpp"
+#include "./types.hpp"
+
+// A recording of a run, everything needed to play it back exactly
+// Instructions and timers are deterministic, so with the same ROM, seed and instructions per second only the key events have to be kept
+struct Movie
+{
+    // "C8MV" when read as bytes on a little endian host
+    static constexpr const uint32_t MAGIC = 0x564D3843;
+    static constexpr const uint32_t VERSION = 1;
+
+    // Checked against the ROM a movie is played back with
+    uint64_t rom_hash = 0;
+    uint64_t seed = 0;
+    uint32_t instructions_per_second = 0;
+    // The length of the run and how the display looked at the end of it, so playback can tell if it went the same way
+    uint64_t cycles = 0;
+    uint64_t framebuffer_hash = 0;
+    // In the order they were applied
+    std::vector<KeyEvent> events;
+
+    // A 64 bit FNV-1a hash of a ROM
+    [[nodiscard]] static uint64_t hash_rom(const std::vector<byte> &rom)
+    {
+        uint64_t hash = 0xCBF29CE484222325;
+        for (byte value : rom)
+        {
+            hash ^= value;
+            hash *= 0x100000001B3;
+        }
+        return hash;
+    }
+};
+
+static inline void put_movie_integer(std::vector<byte> &out, uint64_t value, size_t size)
+{
+    for (size_t idx = 0; idx < size; idx++)
+        out.push_back(value >> (idx * 8));
+}
+
+static inline bool get_movie_integer(const std::vector<byte> &in, size_t &pos, uint64_t &value, size_t size)
+{
+    if (in.size() - pos < size)
+        return false;
+
+    value = 0;
+    for (size_t idx = 0; idx < size; idx++)
+        value |= static_cast<uint64_t>(in[pos++]) << (idx * 8);
+    return true;
+}
+
+static inline bool get_movie_varint(const std::vector<byte> &in, size_t &pos, uint64_t &value)
+{
+    value = 0;
+    for (size_t shift = 0; shift < 64 && pos < in.size(); shift += 7)
+    {
+        const byte part = in[pos++];
+        value |= static_cast<uint64_t>(part & 0x7F) << shift;
+        if (!(part & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Movies are written as a header of little endian integers followed by the events
+// Each event is the instructions since the previous one as a LEB128 varint and a byte holding the key, with the top bit set for a press
+// Most events take two or three bytes
+// Returns whether the whole movie was written
+inline bool write_movie(const std::string &path, const Movie &movie)
+{
+    std::vector<byte> out;
+    put_movie_integer(out, Movie::MAGIC, 4);
+    put_movie_integer(out, Movie::VERSION, 4);
+    put_movie_integer(out, movie.rom_hash, 8);
+    put_movie_integer(out, movie.seed, 8);
+    put_movie_integer(out, movie.instructions_per_second, 4);
+    put_movie_integer(out, movie.cycles, 8);
+    put_movie_integer(out, movie.framebuffer_hash, 8);
+    put_movie_integer(out, movie.events.size(), 8);
+
+    uint64_t previous = 0;
+    for (const KeyEvent &event : movie.events)
+    {
+        for (uint64_t delta = event.cycle - previous; ; delta >>= 7)
+        {
+            out.push_back((delta & 0x7F) | (delta >= 0x80 ? 0x80 : 0));
+            if (delta < 0x80)
+                break;
+        }
+        out.push_back((event.key & 0xF) | (event.down ? 0x80 : 0));
+        previous = event.cycle;
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    const bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+    return fclose(file) == 0 && written;
+}
+
+// Returns false, leaving movie alone, if the file can't be read or isn't a movie of this version
+inline bool read_movie(const std::string &path, Movie &movie)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    std::vector<byte> in;
+    byte buffer[4096];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+        in.insert(in.end(), buffer, buffer + read);
+    fclose(file);
+
+    size_t pos = 0;
+    uint64_t magic, version, instructions_per_second, event_count;
+    Movie read;
+    if (!get_movie_integer(in, pos, magic, 4) || magic != Movie::MAGIC || !get_movie_integer(in, pos, version, 4) || version != Movie::VERSION ||
+        !get_movie_integer(in, pos, read.rom_hash, 8) || !get_movie_integer(in, pos, read.seed, 8) ||
+        !get_movie_integer(in, pos, instructions_per_second, 4) || !get_movie_integer(in, pos, read.cycles, 8) ||
+        !get_movie_integer(in, pos, read.framebuffer_hash, 8) || !get_movie_integer(in, pos, event_count, 8))
+        return false;
+    read.instructions_per_second = instructions_per_second;
+
+    // Every event takes at least two bytes, which keeps a corrupt count from reserving too much
+    if (event_count > (in.size() - pos) / 2)
+        return false;
+    read.events.reserve(event_count);
+
+    uint64_t cycle = 0;
+    for (uint64_t idx = 0; idx < event_count; idx++)
+    {
+        uint64_t delta;
+        if (!get_movie_varint(in, pos, delta) || pos == in.size())
+            return false;
+
+        cycle += delta;
+        const byte key = in[pos++];
+        read.events.push_back({cycle, static_cast<uint8_t>(key & 0xF), (key & 0x80) != 0});
+    }
+
+    if (pos != in.size())
+        return false;
+
+    movie = std::move(read);
+    return true;
+}
+
+// Plays a movie's events back into a Chip 8, in place of the window thread
+class MoviePlayer
+{
+private:
+    const Movie &movie;
+    const std::shared_ptr<KeypadState> keypad;
+
+    // The first event not queued yet
+    size_t next = 0;
+
+public:
+    MoviePlayer(const Movie &movie, const std::shared_ptr<KeypadState> &keypad) : movie(movie), keypad(keypad) {}
+
+    // Execute count clocks like Chip8::run, with every event the movie has for them applied at the instruction count it was recorded at
+    // The chip8 has to be reading from the keypad the player was given, and have been seeded from the movie
+    // Like Chip8::run it returns early once the Chip 8 halts
+    uint32_t run(Chip8 &chip8, uint32_t count)
+    {
+        uint32_t executed = 0;
+        while (executed < count && !chip8.halted())
+        {
+            while (next < movie.events.size() && keypad->push(movie.events[next].key, movie.events[next].down, movie.events[next].cycle))
+                next++;
+
+            // The queue only holds so many events, so don't run past the next one that didn't fit yet
+            uint32_t chunk = count - executed;
+            if (next < movie.events.size())
+                chunk = std::min<uint64_t>(chunk, movie.events[next].cycle - chip8.get_cycles());
+
+            // The queue is full of events for right now, apply them to make room like a run would
+            if (chunk == 0)
+            {
+                keypad->apply_events(chip8.get_cycles());
+                continue;
+            }
+
+            executed += chip8.run(chunk);
+        }
+        return executed;
+    }
+
+    // Whether every event has been queued
+    [[nodiscard]] bool finished() const
+    {
+        return next == movie.events.size();
+    }
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "./Decoder.hpp"
+#include "./types.hpp"
+
+// Where a program spends its instructions, counted by the Chip 8 as it runs
+// Only the thread running the Chip 8 writes the counters, so counting is a plain load and store rather than a locked add
+// Any other thread can read them while it runs
+class Profile
+{
+public:
+    // Names for each Op, in the order they're declared
+    static constexpr const std::array<const char *, static_cast<size_t>(Op::LD_VX_MEM) + 1> OP_NAMES{
+        "Undecoded",
+        "Invalid",
+        "CLS",
+        "RET",
+        "JP addr",
+        "CALL addr",
+        "SE Vx, byte",
+        "SNE Vx, byte",
+        "SE Vx, Vy",
+        "LD Vx, byte",
+        "ADD Vx, byte",
+        "LD Vx, Vy",
+        "OR Vx, Vy",
+        "AND Vx, Vy",
+        "XOR Vx, Vy",
+        "ADD Vx, Vy",
+        "SUB Vx, Vy",
+        "SHR Vx",
+        "SUBN Vx, Vy",
+        "SHL Vx",
+        "SNE Vx, Vy",
+        "LD I, addr",
+        "JP V0, addr",
+        "RND Vx, byte",
+        "DRW Vx, Vy, n",
+        "SKP Vx",
+        "SKNP Vx",
+        "LD Vx, DT",
+        "LD Vx, K",
+        "LD DT, Vx",
+        "LD ST, Vx",
+        "ADD I, Vx",
+        "LD F, Vx",
+        "LD B, Vx",
+        "LD [I], Vx",
+        "LD Vx, [I]",
+    };
+
+    using Counter = std::atomic<uint64_t>;
+
+private:
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> reset_requested{false};
+
+    // Executions of the instruction at each address
+    std::array<Counter, 0x1000> address_counts{};
+    std::array<Counter, OP_NAMES.size()> op_counts{};
+    // Calls to each address
+    std::array<Counter, 0x1000> call_counts{};
+    Counter sprites{0};
+    Counter sprite_pixels{0};
+
+    static inline void bump(Counter &counter, uint64_t amount = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+public:
+    // While unset the Chip 8 doesn't count anything and runs with its selected engine
+    [[nodiscard]] inline bool is_enabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void set_enabled(bool enabled)
+    {
+        this->enabled = enabled;
+    }
+
+    // Zero every counter, which the thread running the Chip 8 does before it next counts
+    void reset()
+    {
+        reset_requested = true;
+    }
+
+    // Only called from the thread running the Chip 8
+    void take_reset()
+    {
+        if (!reset_requested.load(std::memory_order_relaxed) || !reset_requested.exchange(false))
+            return;
+
+        for (Counter &counter : address_counts)
+            counter.store(0, std::memory_order_relaxed);
+        for (Counter &counter : op_counts)
+            counter.store(0, std::memory_order_relaxed);
+        for (Counter &counter : call_counts)
+            counter.store(0, std::memory_order_relaxed);
+        sprites.store(0, std::memory_order_relaxed);
+        sprite_pixels.store(0, std::memory_order_relaxed);
+    }
+
+    inline void executed(addr_t pc, const DecodedInstruction &instruction)
+    {
+        bump(address_counts[pc & 0xFFF]);
+        bump(op_counts[static_cast<size_t>(instruction.op)]);
+        if (instruction.op == Op::CALL)
+            bump(call_counts[instruction.nnn]);
+    }
+
+    inline void drew(const byte *sprite, uint8_t n)
+    {
+        uint64_t pixels = 0;
+        for (uint8_t row = 0; row < n; row++)
+        {
+            for (byte bits = sprite[row]; bits; bits &= bits - 1)
+                pixels++;
+        }
+        bump(sprites);
+        bump(sprite_pixels, pixels);
+    }
+
+    [[nodiscard]] uint64_t get_address_count(addr_t addr) const
+    {
+        return address_counts[addr & 0xFFF].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t get_op_count(Op op) const
+    {
+        return op_counts[static_cast<size_t>(op)].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t get_call_count(addr_t addr) const
+    {
+        return call_counts[addr & 0xFFF].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t get_sprites() const
+    {
+        return sprites.load(std::memory_order_relaxed);
+    }
+
+    // Pixels in every sprite drawn, whether they were set or cleared on the screen
+    [[nodiscard]] uint64_t get_sprite_pixels() const
+    {
+        return sprite_pixels.load(std::memory_order_relaxed);
+    }
+};
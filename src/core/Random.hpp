@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+// The random number generator behind Cxkk, every Chip 8 has its own so runs with the same seed and input are reproducible
+// It's xorshift64*, which is fast, small enough to go in a save state and plenty random for games
+class Random
+{
+public:
+    static constexpr const uint64_t DEFAULT_SEED = 0x43484950382D3634;
+
+private:
+    // Never zero, xorshift would only ever produce zero from it
+    uint64_t state;
+
+public:
+    Random(uint64_t seed = DEFAULT_SEED)
+    {
+        this->seed(seed);
+    }
+
+    // Any seed is fine, it's mixed with splitmix64 so similar seeds give unrelated sequences
+    void seed(uint64_t seed)
+    {
+        uint64_t mixed = seed + 0x9E3779B97F4A7C15;
+        mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EB;
+        mixed ^= mixed >> 31;
+        set_state(mixed);
+    }
+
+    [[nodiscard]] inline uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1D;
+    }
+
+    // The high bits are the most random ones
+    [[nodiscard]] inline uint8_t next_byte()
+    {
+        return next() >> 56;
+    }
+
+    [[nodiscard]] uint64_t get_state() const
+    {
+        return state;
+    }
+
+    void set_state(uint64_t state)
+    {
+        this->state = state ? state : DEFAULT_SEED;
+    }
+};
@@ -0,0 +1,109 @@
+#include <cstring>
+
+#include "./RecompiledEngine.hpp"
+#include "./font.hpp"
+
+std::vector<const RecompiledProgram *> &RecompiledEngine::programs()
+{
+    // Registrations happen during static initialization, so this can't be a plain static member
+    static std::vector<const RecompiledProgram *> registered;
+    return registered;
+}
+
+Registers &RecompiledEngine::registers(Chip8 &chip8)
+{
+    return *chip8.registers;
+}
+
+bool RecompiledEngine::load(const std::vector<byte> &program)
+{
+    this->program = nullptr;
+    for (const RecompiledProgram *recompiled : programs())
+    {
+        if (recompiled->rom_size == program.size() && !std::memcmp(recompiled->rom, program.data(), program.size()))
+        {
+            this->program = recompiled;
+            break;
+        }
+    }
+
+    revalidate();
+    return this->program != nullptr;
+}
+
+void RecompiledEngine::revalidate()
+{
+    blocks.fill(nullptr);
+    if (!program)
+        return;
+
+    // What memory held when the ROM was traced
+    const auto original = [&](addr_t addr) -> byte
+    {
+        if (addr < font.size())
+            return font[addr];
+        if (addr >= 0x200 && addr - 0x200U < program->rom_size)
+            return program->rom[addr - 0x200];
+        return 0;
+    };
+
+    const std::array<byte, 0x1000> &memory = *chip8.memory;
+    for (size_t idx = 0; idx < program->block_count; idx++)
+    {
+        const RecompiledBlock &block = program->blocks[idx];
+
+        bool unchanged = true;
+        for (addr_t byte_addr = block.start; byte_addr != block.end && unchanged; byte_addr++)
+            unchanged = memory[byte_addr & 0xFFF] == original(byte_addr & 0xFFF);
+        if (!unchanged)
+            continue;
+
+        blocks[block.start] = &block;
+
+        // Remember which memory the block was recompiled from so writes to it can drop the block
+        for (addr_t byte_addr = block.start; byte_addr != block.end; byte_addr++)
+            chip8.translated_code[byte_addr & 0xFFF] = true;
+    }
+}
+
+uint32_t RecompiledEngine::run(uint32_t count)
+{
+    Registers &registers = *chip8.registers;
+
+    uint32_t executed = 0;
+    while (executed < count)
+    {
+        // Only run the block when all of it fits, so a run always executes exactly count instructions
+        const RecompiledBlock *block = blocks[registers.pc_reg & 0xFFF];
+        if (block && block->instructions <= count - executed)
+        {
+            block->function(chip8);
+            executed += block->instructions;
+            continue;
+        }
+
+        if (chip8.at_key_wait())
+            break;
+
+        chip8.step();
+        executed++;
+        if (chip8.halted())
+            break;
+    }
+
+    return executed;
+}
+
+void RecompiledEngine::invalidate(addr_t addr)
+{
+    addr &= 0xFFF;
+
+    // Blocks are at most MAX_BLOCK_LENGTH instructions long, so only the starts that close to the address can cover it
+    for (addr_t back = 0; back < MAX_BLOCK_LENGTH * 2; back++)
+    {
+        const addr_t start = (addr - back) & 0xFFF;
+        const RecompiledBlock *block = blocks[start];
+        if (block && ((addr - start) & 0xFFF) < ((block->end - start) & 0xFFF))
+            blocks[start] = nullptr;
+    }
+}
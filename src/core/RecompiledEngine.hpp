@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "./Chip8.hpp"
+#include "./Decoder.hpp"
+#include "./Instructions.hpp"
+#include "./Registers.hpp"
+#include "./types.hpp"
+
+// A basic block of a ROM recompiled ahead of time into C++ by chip8_recompile
+struct RecompiledBlock
+{
+    addr_t start;
+    // The address after the last instruction
+    addr_t end;
+    // The number of instructions the block executes
+    uint16_t instructions;
+    void (*function)(Chip8 &chip8);
+};
+
+// A ROM and every block that chip8_recompile found in it
+struct RecompiledProgram
+{
+    const char *name;
+    const byte *rom;
+    size_t rom_size;
+    const RecompiledBlock *blocks;
+    size_t block_count;
+};
+
+// Runs the Chip 8 using blocks recompiled ahead of time, when the loaded program is one that was recompiled and linked in
+// Code that wasn't found when the ROM was traced, like the targets of Bnnn, is left to the interpreter
+// A block is dropped as soon as memory it was recompiled from is written to, leaving that code to the interpreter too
+class RecompiledEngine
+{
+public:
+    // Recompiled blocks never run longer than this, chip8_recompile splits them to fit
+    static constexpr const size_t MAX_BLOCK_LENGTH = 64;
+
+    // Generated translation units each have one of these, so their program is found when it's loaded
+    class Registration
+    {
+    public:
+        Registration(const RecompiledProgram &program)
+        {
+            programs().push_back(&program);
+        }
+    };
+
+    // Used by recompiled blocks to get at the Chip 8
+    static Registers &registers(Chip8 &chip8);
+
+    // Used by recompiled blocks for instructions that aren't worth generating code for
+    // These don't increment the program counter, just like Chip8::execute_op
+    template <Op op>
+    static inline void execute(Chip8 &chip8, const DecodedInstruction &instruction)
+    {
+        chip8.execute_op<op>(instruction);
+    }
+
+private:
+    Chip8 &chip8;
+
+    // The recompiled version of the loaded program, nullptr if there isn't one
+    const RecompiledProgram *program = nullptr;
+
+    // Blocks by their starting address, nullptr once memory the block was recompiled from is written to
+    std::array<const RecompiledBlock *, 0x1000> blocks{};
+
+    // Every recompiled program linked in
+    static std::vector<const RecompiledProgram *> &programs();
+
+public:
+    RecompiledEngine(Chip8 &chip8) : chip8(chip8) {}
+
+    // Look for a recompiled version of a program that's just been loaded
+    // Returns whether one was found
+    bool load(const std::vector<byte> &program);
+
+    // Drop the blocks whose code in memory no longer matches the ROM, and bring back the ones that match again
+    void revalidate();
+
+    [[nodiscard]] bool loaded() const
+    {
+        return program != nullptr;
+    }
+
+    // Execute up to count instructions, stopping early before an instruction that waits for a key
+    // Returns the number of instructions executed
+    uint32_t run(uint32_t count);
+
+    // Called when memory that's part of a recompiled block is written to
+    void invalidate(addr_t addr);
+
+    // The number of recompiled programs linked in
+    [[nodiscard]] static size_t program_count()
+    {
+        return programs().size();
+    }
+};
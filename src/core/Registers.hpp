@@ -7,7 +7,7 @@
 struct Registers
 {
 public:
-    std::array<reg_t, 0xF> general_regs{};
+    std::array<reg_t, 0x10> general_regs{};
     addr_t addr_reg = 0;
     reg_t delay_reg = 0;
     reg_t sound_reg = 0;
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "./Chip8.hpp"
+#include "./SaveState.hpp"
+
+// Records a save state every frame so the Chip 8 can be stepped back in time
+// Every KEYFRAME_INTERVAL frames a whole state is kept, the frames after it only keep an XOR against it, run length encoded
+// Most of a state doesn't change from frame to frame, so a frame usually takes tens of bytes
+// The oldest frames are thrown away, a keyframe at a time, once the buffer uses more memory than its budget
+class RewindBuffer
+{
+public:
+    static constexpr const size_t KEYFRAME_INTERVAL = 60;
+    static constexpr const size_t DEFAULT_BUDGET = 8 << 20;
+
+private:
+    static_assert(sizeof(SaveState) <= 0xFFFF, "Delta runs are stored as 16 bit lengths");
+
+    // A keyframe and the frames recorded after it
+    struct Group
+    {
+        SaveState keyframe;
+        // Each frame's delta back to back, as pairs of 16 bit lengths of bytes to skip and bytes to XOR, followed by the bytes to XOR
+        std::vector<byte> deltas;
+        // Where each frame's delta ends in deltas
+        std::vector<uint32_t> ends;
+        // The tag recorded with the keyframe followed by the tag recorded with each frame after it
+        std::vector<uint32_t> tags;
+    };
+
+    std::deque<Group> groups;
+
+    // Kept from the last group thrown away, so its memory can be reused
+    Group spare;
+
+    size_t budget;
+    size_t used = 0;
+
+    // Scratch space for the state being recorded or restored
+    SaveState current;
+
+    [[nodiscard]] static size_t group_size(const Group &group)
+    {
+        return sizeof(group.keyframe) + group.deltas.size() + group.ends.size() * sizeof(uint32_t) + group.tags.size() * sizeof(uint32_t);
+    }
+
+    static void push_length(std::vector<byte> &out, size_t length)
+    {
+        out.push_back(length & 0xFF);
+        out.push_back(length >> 8);
+    }
+
+    static void encode_delta(const SaveState &base, const SaveState &state, std::vector<byte> &out)
+    {
+        const byte *a = reinterpret_cast<const byte *>(&base);
+        const byte *b = reinterpret_cast<const byte *>(&state);
+
+        size_t idx = 0;
+        while (idx < sizeof(SaveState))
+        {
+            const size_t start = idx;
+            while (idx < sizeof(SaveState) && a[idx] == b[idx])
+                idx++;
+            if (idx == sizeof(SaveState))
+                break;
+
+            // Short runs of equal bytes are cheaper to XOR than to end the literal for
+            const size_t literal = idx;
+            size_t same = 0;
+            while (idx < sizeof(SaveState) && same < 4)
+            {
+                same = a[idx] == b[idx] ? same + 1 : 0;
+                idx++;
+            }
+            idx -= same;
+
+            push_length(out, literal - start);
+            push_length(out, idx - literal);
+            for (size_t pos = literal; pos < idx; pos++)
+                out.push_back(a[pos] ^ b[pos]);
+        }
+    }
+
+    static void apply_delta(SaveState &state, const byte *delta, const byte *end)
+    {
+        byte *bytes = reinterpret_cast<byte *>(&state);
+
+        size_t idx = 0;
+        while (delta < end)
+        {
+            idx += delta[0] | delta[1] << 8;
+            const size_t count = delta[2] | delta[3] << 8;
+            delta += 4;
+            for (size_t pos = 0; pos < count; pos++)
+                bytes[idx++] ^= *delta++;
+        }
+    }
+
+    void start_group()
+    {
+        Group &group = groups.emplace_back(std::move(spare));
+        spare = Group();
+        group.keyframe = current;
+        group.deltas.clear();
+        group.ends.clear();
+        group.tags.clear();
+    }
+
+public:
+    RewindBuffer(size_t budget = DEFAULT_BUDGET) : budget(budget) {}
+
+    // Record the state at the end of a frame
+    // The tag is handed back when the frame is rewound to, for state that lives outside the Chip 8
+    void record(const Chip8 &chip8, uint32_t tag = 0)
+    {
+        chip8.save_state(current);
+
+        if (groups.empty() || groups.back().ends.size() + 1 >= KEYFRAME_INTERVAL)
+        {
+            start_group();
+            used += sizeof(SaveState);
+        }
+        else
+        {
+            Group &group = groups.back();
+            const size_t before = group.deltas.size();
+            encode_delta(group.keyframe, current, group.deltas);
+            group.ends.push_back(group.deltas.size());
+            used += group.deltas.size() - before + sizeof(uint32_t);
+        }
+        groups.back().tags.push_back(tag);
+        used += sizeof(uint32_t);
+
+        // Always keep the newest group, even if it's over budget on its own
+        while (used > budget && groups.size() > 1)
+        {
+            used -= group_size(groups.front());
+            spare = std::move(groups.front());
+            groups.pop_front();
+        }
+    }
+
+    // Go back to the frame before the last one recorded, dropping the last one
+    // Returns the tag that frame was recorded with, or nothing, leaving the Chip 8 alone, once there's nothing left to go back to
+    std::optional<uint32_t> rewind(Chip8 &chip8)
+    {
+        if (frames() < 2)
+            return std::nullopt;
+
+        // Drop the newest frame
+        Group &newest = groups.back();
+        if (newest.ends.empty())
+        {
+            used -= group_size(newest);
+            groups.pop_back();
+        }
+        else
+        {
+            used -= newest.ends.back() - (newest.ends.size() > 1 ? newest.ends[newest.ends.size() - 2] : 0) + sizeof(uint32_t);
+            newest.ends.pop_back();
+            newest.deltas.resize(newest.ends.empty() ? 0 : newest.ends.back());
+            newest.tags.pop_back();
+            used -= sizeof(uint32_t);
+        }
+
+        // Rebuild the frame that's now the newest
+        const Group &group = groups.back();
+        current = group.keyframe;
+        if (!group.ends.empty())
+        {
+            const size_t start = group.ends.size() > 1 ? group.ends[group.ends.size() - 2] : 0;
+            apply_delta(current, group.deltas.data() + start, group.deltas.data() + group.ends.back());
+        }
+
+        chip8.load_state(current);
+        return group.tags.back();
+    }
+
+    void clear()
+    {
+        groups.clear();
+        used = 0;
+    }
+
+    // The number of frames that can be gone back to, counting the newest one
+    [[nodiscard]] size_t frames() const
+    {
+        size_t count = 0;
+        for (const Group &group : groups)
+            count += 1 + group.ends.size();
+        return count;
+    }
+
+    // The memory used by recorded frames
+    [[nodiscard]] size_t get_used() const
+    {
+        return used;
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+
+#include "./Framebuffer.hpp"
+#include "./Registers.hpp"
+#include "./types.hpp"
+
+// A snapshot of everything that makes up a running Chip 8
+// It's a fixed size with no padding, so saving and restoring are plain copies and the bytes can go straight to a file
+struct SaveState
+{
+    // "C8SS" when read as bytes on a little endian host
+    static constexpr const uint32_t MAGIC = 0x53533843;
+    // Bumped whenever the layout changes, states from other versions aren't loaded
+    static constexpr const uint32_t VERSION = 2;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint64_t cycles = 0;
+    // The state of the Chip 8's Random
+    uint64_t random_state = 0;
+    std::array<byte, 0x1000> memory{};
+    Framebuffer framebuffer{};
+    Registers registers{};
+    std::array<addr_t, 0x10> stack{};
+    // A bit for each key that's down
+    uint16_t keys = 0;
+    uint8_t stack_pointer = 0;
+    // A CpuState
+    uint8_t state = 0;
+    std::array<uint8_t, 6> reserved{};
+};
+
+static_assert(std::is_trivially_copyable_v<SaveState>, "Save states have to be copyable as bytes");
+static_assert(std::has_unique_object_representations_v<SaveState>, "Save states can't have padding, it would make checksums unreliable");
+
+// Save states are written to files as the raw struct followed by an FNV-1a checksum of it, in the host's byte order
+[[nodiscard]] inline uint64_t save_state_checksum(const SaveState &state)
+{
+    const byte *bytes = reinterpret_cast<const byte *>(&state);
+    uint64_t hash = 0xCBF29CE484222325;
+    for (size_t idx = 0; idx < sizeof(state); idx++)
+    {
+        hash ^= bytes[idx];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+// Returns whether the whole state was written
+inline bool write_save_state(const std::string &path, const SaveState &state)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    const uint64_t checksum = save_state_checksum(state);
+    const bool written = fwrite(&state, sizeof(state), 1, file) == 1 && fwrite(&checksum, sizeof(checksum), 1, file) == 1;
+    return fclose(file) == 0 && written;
+}
+
+// Returns false, leaving state alone, if the file can't be read, is the wrong size or version, or fails its checksum
+inline bool read_save_state(const std::string &path, SaveState &state)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    SaveState read;
+    uint64_t checksum;
+    const bool complete = fread(&read, sizeof(read), 1, file) == 1 && fread(&checksum, sizeof(checksum), 1, file) == 1 && fgetc(file) == EOF;
+    fclose(file);
+
+    if (!complete || read.magic != SaveState::MAGIC || read.version != SaveState::VERSION || checksum != save_state_checksum(read))
+        return false;
+
+    state = read;
+    return true;
+}
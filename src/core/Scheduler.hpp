@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <thread>
+
+#include "./Chip8.hpp"
+#include "./RewindBuffer.hpp"
+
+// Runs the Chip 8 in 60 hz frames
+// Every frame executes a batch of instructions and then ticks the delay and sound timers once
+class Scheduler
+{
+public:
+    static constexpr const uint32_t FRAMES_PER_SECOND = 60;
+    static constexpr const uint32_t DEFAULT_INSTRUCTIONS_PER_SECOND = 500;
+    static constexpr const std::chrono::nanoseconds FRAME_TIME{1000000000 / FRAMES_PER_SECOND};
+
+    // If the scheduler falls further behind than this, it gives up on catching up
+    static constexpr const uint32_t MAX_FRAMES_BEHIND = 5;
+
+private:
+    std::atomic<uint32_t> instructions_per_second{DEFAULT_INSTRUCTIONS_PER_SECOND};
+
+    // When set, frames run back to back without waiting for real time to pass
+    std::atomic<bool> turbo{false};
+
+    // When set, every frame, or one per real frame in turbo, is recorded so it can be rewound to
+    std::atomic<bool> rewind_enabled{true};
+
+    // When set, frames are played back in reverse instead of run
+    std::atomic<bool> rewinding{false};
+
+    // Only used by the thread running frames
+    RewindBuffer rewind_buffer;
+
+    // Instructions per second rarely divides evenly into frames, so the leftover is carried into the next frame
+    uint32_t leftover = 0;
+
+public:
+    void set_instructions_per_second(uint32_t instructions_per_second)
+    {
+        this->instructions_per_second = std::max<uint32_t>(instructions_per_second, 1);
+    }
+
+    [[nodiscard]] uint32_t get_instructions_per_second() const
+    {
+        return instructions_per_second;
+    }
+
+    void set_turbo(bool turbo)
+    {
+        this->turbo = turbo;
+    }
+
+    [[nodiscard]] bool get_turbo() const
+    {
+        return turbo;
+    }
+
+    void set_rewind_enabled(bool rewind_enabled)
+    {
+        this->rewind_enabled = rewind_enabled;
+    }
+
+    [[nodiscard]] bool get_rewind_enabled() const
+    {
+        return rewind_enabled;
+    }
+
+    // Hold this to play frames back in reverse, until it's released or the oldest recorded frame is reached
+    void set_rewinding(bool rewinding)
+    {
+        this->rewinding = rewinding;
+    }
+
+    [[nodiscard]] bool get_rewinding() const
+    {
+        return rewinding;
+    }
+
+    // The number of instructions to execute in the next frame
+    uint32_t next_frame_instructions()
+    {
+        const uint32_t total = instructions_per_second + leftover;
+        leftover = total % FRAMES_PER_SECOND;
+        return total / FRAMES_PER_SECOND;
+    }
+
+    // Execute a single frame without waiting
+    // Returns the number of instructions executed
+    uint32_t run_frame(Chip8 &chip8)
+    {
+        // Waiting for a key doesn't block, the rest of the frame just passes without executing anything
+        const uint32_t executed = chip8.run(next_frame_instructions());
+        chip8.tick_timers();
+        return executed;
+    }
+
+    // Execute frames on real frame boundaries until keep_running returns false
+    void run(Chip8 &chip8, const std::function<bool()> &keep_running)
+    {
+        rewind_buffer.clear();
+
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point next_record = deadline;
+        while (keep_running())
+        {
+            // Rewinding goes back a frame at a time at the same rate frames normally run
+            if (rewinding)
+            {
+                // Frames have to keep ending at the same instruction counts as the first time through for runs to be reproducible
+                if (const std::optional<uint32_t> recorded_leftover = rewind_buffer.rewind(chip8))
+                    leftover = *recorded_leftover;
+            }
+            else
+            {
+                run_frame(chip8);
+            }
+
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+            // Turbo runs frames much faster than real time, recording each of them would slow it down and fill the buffer in seconds
+            // Only one frame is recorded per real frame instead, so rewinding always goes back at the speed things were seen
+            if (!rewinding && rewind_enabled && (!turbo || now >= next_record))
+            {
+                rewind_buffer.record(chip8, leftover);
+                next_record = now + FRAME_TIME;
+            }
+
+            // There's nothing to hurry through while waiting for a key or halted, so turbo sleeps like any other frame
+            if ((turbo && !rewinding && !chip8.waiting_for_key() && !chip8.halted()) || now - deadline > FRAME_TIME * MAX_FRAMES_BEHIND)
+            {
+                deadline = now;
+                continue;
+            }
+
+            deadline += FRAME_TIME;
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+};
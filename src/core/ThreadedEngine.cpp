@@ -0,0 +1,293 @@
+#include <algorithm>
+
+#include "./ThreadedEngine.hpp"
+#include "./Chip8.hpp"
+#include "./get_bits.hpp"
+#include "./Instructions.hpp"
+
+template <Op kind>
+uint32_t ThreadedEngine::straight_line(Chip8 &chip8, const ThreadedOp &op, uint32_t)
+{
+    chip8.execute_op<kind>(op.instruction);
+    return 1;
+}
+
+template <Op kind>
+uint32_t ThreadedEngine::control_flow(Chip8 &chip8, const ThreadedOp &op, uint32_t)
+{
+    chip8.registers->pc_reg = op.pc;
+    if constexpr (kind == Op::Invalid)
+    {
+        chip8.execute(op.instruction);
+    }
+    else
+    {
+        chip8.execute_op<kind>(op.instruction);
+        chip8.registers->pc_reg = (chip8.registers->pc_reg + 2) & 0xFFF;
+    }
+    return 1;
+}
+
+uint32_t ThreadedEngine::load_delay_timer(Chip8 &chip8, const ThreadedOp &op, uint32_t)
+{
+    chip8.registers->general_regs[op.instruction.x] = op.instruction.kk;
+    chip8.registers->delay_reg = op.instruction.kk;
+    return 2;
+}
+
+uint32_t ThreadedEngine::poll_delay_timer(Chip8 &chip8, const ThreadedOp &op, uint32_t budget)
+{
+    Registers &registers = *chip8.registers;
+    registers.general_regs[op.instruction.x] = registers.delay_reg;
+
+    // The timer has reached the value, so the jump back is skipped
+    if (registers.delay_reg == op.instruction.kk)
+    {
+        registers.pc_reg = (op.pc + 6) & 0xFFF;
+        return 2;
+    }
+
+    // Every iteration leaves the same state behind, so only the number of them matters
+    registers.pc_reg = op.pc;
+    return budget - budget % 3;
+}
+
+ThreadedEngine::Handler ThreadedEngine::straight_line_handler(Op op)
+{
+    switch (op)
+    {
+    case Op::CLS:
+        return straight_line<Op::CLS>;
+    case Op::LD_BYTE:
+        return straight_line<Op::LD_BYTE>;
+    case Op::ADD_BYTE:
+        return straight_line<Op::ADD_BYTE>;
+    case Op::LD_REG:
+        return straight_line<Op::LD_REG>;
+    case Op::OR:
+        return straight_line<Op::OR>;
+    case Op::AND:
+        return straight_line<Op::AND>;
+    case Op::XOR:
+        return straight_line<Op::XOR>;
+    case Op::ADD_REG:
+        return straight_line<Op::ADD_REG>;
+    case Op::SUB:
+        return straight_line<Op::SUB>;
+    case Op::SHR:
+        return straight_line<Op::SHR>;
+    case Op::SUBN:
+        return straight_line<Op::SUBN>;
+    case Op::SHL:
+        return straight_line<Op::SHL>;
+    case Op::LD_I:
+        return straight_line<Op::LD_I>;
+    case Op::RND:
+        return straight_line<Op::RND>;
+    case Op::LD_VX_DT:
+        return straight_line<Op::LD_VX_DT>;
+    case Op::LD_DT_VX:
+        return straight_line<Op::LD_DT_VX>;
+    case Op::LD_ST_VX:
+        return straight_line<Op::LD_ST_VX>;
+    case Op::ADD_I:
+        return straight_line<Op::ADD_I>;
+    case Op::LD_F:
+        return straight_line<Op::LD_F>;
+    case Op::LD_VX_MEM:
+        return straight_line<Op::LD_VX_MEM>;
+    default:
+        return nullptr;
+    }
+}
+
+ThreadedEngine::Handler ThreadedEngine::control_flow_handler(Op op)
+{
+    switch (op)
+    {
+    case Op::RET:
+        return control_flow<Op::RET>;
+    case Op::JP:
+        return control_flow<Op::JP>;
+    case Op::CALL:
+        return control_flow<Op::CALL>;
+    case Op::SE_BYTE:
+        return control_flow<Op::SE_BYTE>;
+    case Op::SNE_BYTE:
+        return control_flow<Op::SNE_BYTE>;
+    case Op::SE_REG:
+        return control_flow<Op::SE_REG>;
+    case Op::SNE_REG:
+        return control_flow<Op::SNE_REG>;
+    case Op::JP_V0:
+        return control_flow<Op::JP_V0>;
+    case Op::DRW:
+        return control_flow<Op::DRW>;
+    case Op::SKP:
+        return control_flow<Op::SKP>;
+    case Op::SKNP:
+        return control_flow<Op::SKNP>;
+    case Op::LD_VX_K:
+        return control_flow<Op::LD_VX_K>;
+    case Op::LD_B:
+        return control_flow<Op::LD_B>;
+    case Op::LD_MEM_VX:
+        return control_flow<Op::LD_MEM_VX>;
+    default:
+        return control_flow<Op::Invalid>;
+    }
+}
+
+ThreadedEngine::Block *ThreadedEngine::translate(addr_t pc)
+{
+    std::unique_ptr<Block> block = std::make_unique<Block>();
+
+    addr_t addr = pc;
+    while (block->ops.size() < MAX_BLOCK_LENGTH)
+    {
+        const DecodedInstruction instruction = decode(chip8.fetch(addr));
+        const DecodedInstruction next = decode(chip8.fetch(addr + 2));
+
+        // 6xkk, Fx15
+        if (instruction.op == Op::LD_BYTE && next.op == Op::LD_DT_VX && next.x == instruction.x)
+        {
+            block->ops.push_back({load_delay_timer, instruction, static_cast<addr_t>(addr & 0xFFF)});
+            block->min_budget += 2;
+            addr += 4;
+            continue;
+        }
+
+        // Fx07, 3xkk, 1nnn back to the Fx07
+        if (instruction.op == Op::LD_VX_DT && next.op == Op::SE_BYTE && next.x == instruction.x)
+        {
+            const DecodedInstruction jump = decode(chip8.fetch(addr + 4));
+            if (jump.op == Op::JP && jump.nnn == (addr & 0xFFF))
+            {
+                block->ops.push_back({poll_delay_timer, next, static_cast<addr_t>(addr & 0xFFF)});
+                block->min_budget += 3;
+                block->terminated = true;
+                addr += 6;
+                break;
+            }
+        }
+
+        // Waiting for a key and halting are left to the caller, so the block stops right before them
+        if (instruction.op == Op::LD_VX_K || instruction.op == Op::Invalid)
+            break;
+
+        if (Handler handler = straight_line_handler(instruction.op))
+        {
+            block->ops.push_back({handler, instruction, static_cast<addr_t>(addr & 0xFFF)});
+            block->min_budget += 1;
+            addr += 2;
+            continue;
+        }
+
+        block->ops.push_back({control_flow_handler(instruction.op), instruction, static_cast<addr_t>(addr & 0xFFF)});
+        block->min_budget += 1;
+        block->terminated = true;
+        addr += 2;
+        break;
+    }
+    block->end = addr;
+
+    // Remember which memory the block was translated from so writes to it can invalidate the block
+    for (addr_t byte_addr = pc; byte_addr != addr; byte_addr++)
+    {
+        chip8.translated_code[byte_addr & 0xFFF] = true;
+        block->pages |= 1 << ((byte_addr & 0xFFF) >> 8);
+    }
+
+    for (size_t page = 0; page < page_blocks.size(); page++)
+    {
+        if (get_bits(block->pages, page, 1))
+            page_blocks[page].push_back(pc & 0xFFF);
+    }
+
+    blocks[pc & 0xFFF] = std::move(block);
+    return blocks[pc & 0xFFF].get();
+}
+
+uint32_t ThreadedEngine::run(uint32_t count)
+{
+    Registers &registers = *chip8.registers;
+
+    uint32_t executed = 0;
+    while (executed < count)
+    {
+        const addr_t pc = registers.pc_reg & 0xFFF;
+        Block *block = blocks[pc].get();
+        if (!block || !block->valid)
+            block = translate(pc);
+
+        // The block is empty when it starts at an instruction that waits for a key or is invalid
+        if (block->ops.empty())
+            break;
+
+        // Fall back to the interpreter when the whole block might not fit, so a run always executes exactly count instructions
+        if (block->min_budget > count - executed)
+        {
+            chip8.step();
+            executed++;
+            continue;
+        }
+
+        for (const ThreadedOp &op : block->ops)
+            executed += op.handler(chip8, op, count - executed);
+
+        if (!block->terminated)
+            registers.pc_reg = block->end & 0xFFF;
+    }
+
+    return executed;
+}
+
+void ThreadedEngine::invalidate(addr_t addr)
+{
+    addr &= 0xFFF;
+
+    // Invalidate every block the address is part of
+    // A block that spans several pages is forgotten by all of them, so retranslating it doesn't leave extra starts behind
+    std::vector<addr_t> &starts = page_blocks[addr >> 8];
+    for (size_t idx = 0; idx < starts.size();)
+    {
+        const addr_t start = starts[idx];
+        Block *block = blocks[start].get();
+        if (((addr - start) & 0xFFF) >= static_cast<addr_t>(block->end - start))
+        {
+            idx++;
+            continue;
+        }
+
+        block->valid = false;
+        forget(start, block->pages);
+    }
+}
+
+void ThreadedEngine::forget(addr_t start, uint16_t pages)
+{
+    for (size_t page = 0; page < page_blocks.size(); page++)
+    {
+        if (!get_bits(pages, page, 1))
+            continue;
+
+        std::vector<addr_t> &starts = page_blocks[page];
+        const auto found = std::find(starts.begin(), starts.end(), start);
+        if (found != starts.end())
+        {
+            *found = starts.back();
+            starts.pop_back();
+        }
+    }
+}
+
+void ThreadedEngine::clear()
+{
+    for (std::unique_ptr<Block> &block : blocks)
+        block.reset();
+
+    for (std::vector<addr_t> &starts : page_blocks)
+        starts.clear();
+
+    chip8.translated_code.reset();
+}
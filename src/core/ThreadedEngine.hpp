@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "./Decoder.hpp"
+#include "./types.hpp"
+
+class Chip8;
+
+// Runs the Chip 8 by translating each basic block into threaded code the first time it's reached
+// A block is a list of handlers that each execute one instruction, or a few commonly paired instructions fused together
+// Blocks end at anything that changes the program counter, draws, waits for a key or writes memory
+class ThreadedEngine
+{
+public:
+    static constexpr const size_t MAX_BLOCK_LENGTH = 64;
+
+private:
+    struct ThreadedOp;
+
+    // Executes an op and returns the number of instructions it executed
+    // budget is the number of instructions that can still be executed
+    typedef uint32_t (*Handler)(Chip8 &chip8, const ThreadedOp &op, uint32_t budget);
+
+    struct ThreadedOp
+    {
+        Handler handler;
+        DecodedInstruction instruction;
+        // The address of the first instruction in the op
+        addr_t pc;
+    };
+
+    struct Block
+    {
+        std::vector<ThreadedOp> ops;
+        // The address after the last instruction, where execution continues if the block doesn't end in control flow
+        addr_t end = 0;
+        // A bit for each 256 byte page the block was translated from, its start is in the page_blocks of each of them
+        uint16_t pages = 0;
+        // Whether the last op sets the program counter itself
+        bool terminated = false;
+        // The number of instructions the block can need, it's only entered when that many are left to execute
+        uint32_t min_budget = 0;
+        // Cleared when memory the block was translated from is written to
+        bool valid = true;
+    };
+
+    Chip8 &chip8;
+
+    // Translated blocks by their starting address
+    std::array<std::unique_ptr<Block>, 0x1000> blocks{};
+
+    // The starting addresses of the blocks that overlap each 256 byte page, used to find the blocks a write hits
+    std::array<std::vector<addr_t>, 0x10> page_blocks{};
+
+    // An instruction that can't change the program counter or memory, so it never ends a block
+    template <Op kind>
+    static uint32_t straight_line(Chip8 &chip8, const ThreadedOp &op, uint32_t budget);
+
+    // An instruction that ends a block, the program counter is set to the instruction's before executing it
+    template <Op kind>
+    static uint32_t control_flow(Chip8 &chip8, const ThreadedOp &op, uint32_t budget);
+
+    // 6xkk, Fx15 - LD Vx, byte then LD DT, Vx
+    static uint32_t load_delay_timer(Chip8 &chip8, const ThreadedOp &op, uint32_t budget);
+
+    // Fx07, 3xkk, 1nnn - A loop waiting for the delay timer to reach kk
+    // The delay timer can't change in the middle of a run, so every iteration that fits in the budget is done at once
+    static uint32_t poll_delay_timer(Chip8 &chip8, const ThreadedOp &op, uint32_t budget);
+
+    // Returns nullptr if the instruction ends a block
+    static Handler straight_line_handler(Op op);
+    static Handler control_flow_handler(Op op);
+
+    Block *translate(addr_t pc);
+
+    // Take a block's start out of the page_blocks of every page it covers
+    void forget(addr_t start, uint16_t pages);
+
+public:
+    ThreadedEngine(Chip8 &chip8) : chip8(chip8) {}
+
+    // Execute up to count instructions, stopping early before an instruction that waits for a key
+    // Returns the number of instructions executed
+    uint32_t run(uint32_t count);
+
+    // Called when memory that's part of a translated block is written to
+    void invalidate(addr_t addr);
+
+    // Throw away every translated block
+    void clear();
+};
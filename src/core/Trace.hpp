@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "./Decoder.hpp"
+#include "./Registers.hpp"
+#include "./types.hpp"
+
+// An instruction the Chip 8 executed, as it was left after executing it
+struct TraceEntry
+{
+    uint64_t cycle;
+    addr_t pc;
+    inst_t opcode;
+    addr_t addr_reg;
+    // The general register the instruction wrote, or Trace::NO_REGISTER
+    uint8_t changed;
+    reg_t value;
+};
+
+static_assert(sizeof(TraceEntry) == 16 && std::has_unique_object_representations_v<TraceEntry>, "Trace entries are written to files as they are");
+
+// The last instructions the Chip 8 executed, kept in a ring so history from millions of cycles in can be looked at
+// Only the thread running the Chip 8 records, without locking, and it also does the dumping so the ring never has to be copied while it's written
+// A dump is a header followed by the entries from oldest to newest, in the host's byte order
+class Trace
+{
+public:
+    // "C8TR" when read as bytes on a little endian host
+    static constexpr const uint32_t MAGIC = 0x52543843;
+    static constexpr const uint32_t VERSION = 1;
+
+    static constexpr const uint8_t NO_REGISTER = 0xFF;
+
+    // A megabyte of entries
+    static constexpr const size_t DEFAULT_CAPACITY = 1 << 16;
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t count;
+    };
+
+    // The capacity is a power of two so the ring can be indexed with a mask
+    std::vector<TraceEntry> entries;
+    const uint64_t mask;
+    std::atomic<uint64_t> recorded{0};
+
+    // The cycle of the next instruction, kept in step with the Chip 8 by set_cycle
+    uint64_t cycle = 0;
+
+    std::atomic<bool> enabled{false};
+
+    // Only instructions in this range of cycles are recorded, and the ring is dumped once the last one is
+    std::atomic<uint64_t> from{0};
+    std::atomic<uint64_t> to{UINT64_MAX};
+
+    std::atomic<bool> dump_requested{false};
+    std::atomic<uint64_t> dumps{0};
+    std::atomic<bool> dump_failed{false};
+
+    mutable std::mutex path_mtx;
+    std::string path = "trace.c8t";
+
+public:
+    // The capacity has to be a power of two
+    Trace(size_t capacity = DEFAULT_CAPACITY) : entries(capacity), mask(capacity - 1) {}
+
+    // The register an instruction writes, other than VF being used as a flag by arithmetic
+    [[nodiscard]] static constexpr uint8_t written_register(Op op, uint8_t x)
+    {
+        switch (op)
+        {
+        case Op::LD_BYTE:
+        case Op::ADD_BYTE:
+        case Op::LD_REG:
+        case Op::OR:
+        case Op::AND:
+        case Op::XOR:
+        case Op::ADD_REG:
+        case Op::SUB:
+        case Op::SHR:
+        case Op::SUBN:
+        case Op::SHL:
+        case Op::RND:
+        case Op::LD_VX_DT:
+        case Op::LD_VX_K:
+        case Op::LD_VX_MEM:
+            return x;
+        case Op::DRW:
+            return 0xF;
+        default:
+            return NO_REGISTER;
+        }
+    }
+
+    // While unset the Chip 8 doesn't record anything and runs with its selected engine
+    [[nodiscard]] inline bool is_enabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void set_enabled(bool enabled)
+    {
+        this->enabled = enabled;
+    }
+
+    // Record cycles from through to, and dump the ring once cycle to has been recorded
+    void set_range(uint64_t from, uint64_t to)
+    {
+        this->from = from;
+        this->to = to;
+    }
+
+    [[nodiscard]] uint64_t get_from() const
+    {
+        return from;
+    }
+
+    [[nodiscard]] uint64_t get_to() const
+    {
+        return to;
+    }
+
+    void set_path(const std::string &path)
+    {
+        std::unique_lock<std::mutex> lock(path_mtx);
+        this->path = path;
+    }
+
+    [[nodiscard]] std::string get_path() const
+    {
+        std::unique_lock<std::mutex> lock(path_mtx);
+        return path;
+    }
+
+    // Only called from the thread running the Chip 8
+    void set_cycle(uint64_t cycle)
+    {
+        this->cycle = cycle;
+    }
+
+    // Only called from the thread running the Chip 8, right after it executes an instruction
+    inline void record(addr_t pc, inst_t opcode, uint8_t changed, const Registers &registers)
+    {
+        const uint64_t at = cycle++;
+        if (at < from.load(std::memory_order_relaxed) || at > to.load(std::memory_order_relaxed))
+            return;
+
+        const uint64_t index = recorded.load(std::memory_order_relaxed);
+        entries[index & mask] = {at, pc, opcode, registers.addr_reg, changed, changed == NO_REGISTER ? reg_t(0) : registers.general_regs[changed]};
+        recorded.store(index + 1, std::memory_order_release);
+
+        if (at == to.load(std::memory_order_relaxed))
+            dump();
+    }
+
+    // Ask the thread running the Chip 8 to dump the ring the next time it runs
+    void request_dump()
+    {
+        dump_requested = true;
+    }
+
+    // Only called from the thread running the Chip 8
+    void take_dump_request()
+    {
+        if (dump_requested.load(std::memory_order_relaxed) && dump_requested.exchange(false))
+            dump();
+    }
+
+    // Write the ring to the path, only called from the thread running the Chip 8 or while it's stopped
+    // Returns whether the whole ring was written
+    bool dump()
+    {
+        const uint64_t count = std::min<uint64_t>(recorded, entries.size());
+        const uint64_t first = recorded - count;
+
+        FILE *file = fopen(get_path().c_str(), "wb");
+        bool written = file != nullptr;
+        if (file)
+        {
+            const Header header{MAGIC, VERSION, count};
+            written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+            // The ring wraps around at most once, so the entries are in two pieces at most
+            const uint64_t start = first & mask;
+            const uint64_t before_end = std::min<uint64_t>(count, entries.size() - start);
+            written = written && fwrite(entries.data() + start, sizeof(TraceEntry), before_end, file) == before_end;
+            written = written && fwrite(entries.data(), sizeof(TraceEntry), count - before_end, file) == count - before_end;
+            written = fclose(file) == 0 && written;
+        }
+
+        dump_failed = !written;
+        dumps++;
+        return written;
+    }
+
+    // The number of instructions recorded, including ones the ring no longer holds
+    [[nodiscard]] uint64_t get_recorded() const
+    {
+        return recorded.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t get_dumps() const
+    {
+        return dumps;
+    }
+
+    [[nodiscard]] bool last_dump_failed() const
+    {
+        return dump_failed;
+    }
+
+    // Returns false if the file can't be read or isn't a complete trace of this version
+    static bool read(const std::string &path, std::vector<TraceEntry> &trace)
+    {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+
+        Header header;
+        bool complete = fread(&header, sizeof(header), 1, file) == 1 && header.magic == MAGIC && header.version == VERSION && header.count <= UINT32_MAX;
+        if (complete)
+        {
+            std::vector<TraceEntry> read(header.count);
+            complete = fread(read.data(), sizeof(TraceEntry), read.size(), file) == read.size() && fgetc(file) == EOF;
+            if (complete)
+                trace = std::move(read);
+        }
+        fclose(file);
+        return complete;
+    }
+};
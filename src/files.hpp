@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./core/types.hpp"
+
+// Read a whole file, returns false if it can't be opened
+inline bool read_file(const std::string &path, std::vector<byte> &data)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+
+    data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Write a file under a temporary name and rename it into place, so readers never see half of it
+// Returns whether the whole file was written
+inline bool write_file_atomically(const std::filesystem::path &path, const void *data, size_t size)
+{
+    std::error_code error;
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path(), error);
+
+    std::string temporary = path.string() + ".XXXXXX";
+    const int fd = mkstemp(temporary.data());
+    if (fd < 0)
+        return false;
+
+    // Temporary files are only readable by their owner, but the file they become is for everyone
+    bool written = fchmod(fd, 0644) == 0;
+    for (size_t done = 0; done < size && written;)
+    {
+        const ssize_t count = ::write(fd, static_cast<const byte *>(data) + done, size - done);
+        written = count > 0;
+        done += written ? count : 0;
+    }
+    written = ::close(fd) == 0 && written && std::rename(temporary.c_str(), path.c_str()) == 0;
+
+    if (!written)
+        std::remove(temporary.c_str());
+    return written;
+}
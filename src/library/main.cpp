@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../RomLibrary.hpp"
+
+// Builds a ROM library from directories of .ch8 files, or lists what's in one
+// Usage: chip8_library [--pack] -o library.c8lib directory...
+//        chip8_library --list library.c8lib
+// A packed library holds the ROMs themselves, an unpacked one points at their files
+
+static const char *platform_name(Platform platform)
+{
+    switch (platform)
+    {
+    case Platform::SuperChip:
+        return "superchip";
+    case Platform::XoChip:
+        return "xochip";
+    default:
+        return "chip8";
+    }
+}
+
+static std::string quirk_names(uint8_t quirks)
+{
+    std::string names;
+    const auto add = [&](uint8_t quirk, const char *name)
+    {
+        if (!(quirks & quirk))
+            return;
+        if (!names.empty())
+            names += ",";
+        names += name;
+    };
+    add(Quirk::SHIFT, "shift");
+    add(Quirk::LOAD_STORE, "load-store");
+    add(Quirk::JUMP, "jump");
+    add(Quirk::LOGIC, "logic");
+    return names.empty() ? "-" : names;
+}
+
+static int list(const char *path)
+{
+    RomLibrary library;
+    if (!library.open(path))
+    {
+        fprintf(stderr, "%s isn't a ROM library\n", path);
+        return 1;
+    }
+
+    for (size_t idx = 0; idx < library.size(); idx++)
+    {
+        RomLibrary::Rom rom;
+        if (!library.get(idx, rom))
+        {
+            fprintf(stderr, "Entry %zu is damaged\n", idx);
+            return 1;
+        }
+
+        std::string hash;
+        for (uint8_t part : rom.hash)
+        {
+            static constexpr const char DIGITS[] = "0123456789abcdef";
+            hash += DIGITS[part >> 4];
+            hash += DIGITS[part & 0xF];
+        }
+        printf("%.*s\t%zu\t%s\t%s\t%s\t%s\n", static_cast<int>(rom.name.size()), rom.name.data(), rom.size, hash.c_str(), platform_name(rom.platform),
+               quirk_names(rom.quirks).c_str(), rom.data ? "packed" : std::string(rom.path).c_str());
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *output_path = nullptr;
+    bool pack = false;
+    std::vector<std::string> directories;
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "--list") && idx + 1 < argc && argc == 3)
+        {
+            return list(argv[idx + 1]);
+        }
+        else if (!strcmp(argv[idx], "-o") && idx + 1 < argc)
+        {
+            output_path = argv[++idx];
+        }
+        else if (!strcmp(argv[idx], "--pack"))
+        {
+            pack = true;
+        }
+        else if (argv[idx][0] == '-')
+        {
+            directories.clear();
+            break;
+        }
+        else
+        {
+            directories.push_back(argv[idx]);
+        }
+    }
+
+    if (!output_path || directories.empty())
+    {
+        fprintf(stderr, "Usage: %s [--pack] -o library.c8lib directory...\n       %s --list library.c8lib\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    std::string error;
+    const long count = RomLibrary::build(directories, output_path, pack, error);
+    if (count < 0)
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "%ld ROMs in %s\n", count, output_path);
+    return 0;
+}
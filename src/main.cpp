@@ -1,32 +1,81 @@
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <random>
+#include <curl/curl.h>
 #include <SFML/Graphics.hpp>
 #include <imgui.h>
 #include <imgui-SFML.h>
 
-#include "./Chip8.hpp"
+#include "./core/Chip8.hpp"
+#include "./core/Movie.hpp"
+#include "./core/Scheduler.hpp"
+#include "./Display.hpp"
 #include "./Keypad.hpp"
 #include "./Debugger.hpp"
 #include "./main_menu.hpp"
 #include "./threads/window.hpp"
 
+// Usage: chip8 [--seed N] [--record movie.c8m]
+// Recorded movies can be played back with chip8_batch --movie
 int main(int argc, char **argv)
 {
-    sf::RenderWindow window(sf::VideoMode(Chip8::SCREEN_WIDTH * Chip8::PIXEL_SIZE, Chip8::SCREEN_HEIGHT * Chip8::PIXEL_SIZE + Keypad::KEYPAD_SIZE), "Chip 8 Emulator", sf::Style::Default ^ sf::Style::Resize);
+    // Games get different random numbers every time unless a seed is given
+    uint64_t seed = std::random_device()();
+    std::shared_ptr<Movie> movie;
+    std::string movie_path;
+    for (int idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "--seed") && idx + 1 < argc)
+        {
+            seed = std::strtoull(argv[++idx], nullptr, 0);
+        }
+        else if (!strcmp(argv[idx], "--record") && idx + 1 < argc)
+        {
+            movie = std::make_shared<Movie>();
+            movie_path = argv[++idx];
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--seed N] [--record movie.c8m]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // curl's global setup isn't thread safe, and the prefetcher and the ROM loader both use curl from their own threads
+    // Cleaning up is left to exit, so it happens after the threads are joined and after the menu's prefetcher has stopped
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    std::atexit(curl_global_cleanup);
+
+    sf::RenderWindow window(sf::VideoMode(Chip8::SCREEN_WIDTH * Display::PIXEL_SIZE, Chip8::SCREEN_HEIGHT * Display::PIXEL_SIZE + Keypad::KEYPAD_SIZE), "Chip 8 Emulator", sf::Style::Default ^ sf::Style::Resize);
     ImGui::SFML::Init(window);
 
     std::shared_ptr<Keypad> keypad = std::make_shared<Keypad>();
-    std::shared_ptr<Chip8> chip8 = std::make_shared<Chip8>(keypad);
+    std::shared_ptr<Chip8> chip8 = std::make_shared<Chip8>(keypad->get_state());
+    chip8->seed(seed);
+    std::shared_ptr<Scheduler> scheduler = std::make_shared<Scheduler>();
     std::shared_ptr<Debugger> debugger;
-    keypad->add_key_press_handler(chip8);
 
     std::unique_ptr<std::thread> clock_thread;
-    std::unique_ptr<std::thread> window_thread = create_window_thread(window, keypad, chip8, clock_thread, debugger);
+    std::unique_ptr<std::thread> window_thread = create_window_thread(window, keypad, chip8, scheduler, clock_thread, debugger, movie);
 
     window_thread->join();
     if (clock_thread)
         clock_thread->join();
 
+    // The movie was started when the program was, so there's only something to save if it was
+    if (movie && clock_thread)
+    {
+        keypad->get_state()->record(nullptr);
+        movie->seed = seed;
+        movie->cycles = chip8->get_cycles();
+        movie->framebuffer_hash = chip8->get_framebuffer().hash();
+        if (!write_movie(movie_path, *movie))
+            fprintf(stderr, "Couldn't write movie %s\n", movie_path.c_str());
+    }
+
     return 0;
 }
@@ -1,18 +1,40 @@
 #pragma once
 
+#include <chrono>
+#include <future>
 #include <imgui.h>
 
+#include "./Debugger.hpp"
+#include "./Display.hpp"
+#include "./Keypad.hpp"
+#include "./core/Movie.hpp"
 #include "./threads/clock.hpp"
+#include "./Prefetcher.hpp"
 #include "./Programs.hpp"
+#include "./RomLibrary.hpp"
 
-void main_menu(const sf::RenderWindow &window, const std::shared_ptr<Chip8> &chip8, std::unique_ptr<std::thread> &clock_thread, std::shared_ptr<Debugger> &debugger)
+void main_menu(const sf::RenderWindow &window, const std::shared_ptr<Keypad> &keypad, const std::shared_ptr<Chip8> &chip8, const std::shared_ptr<Scheduler> &scheduler, std::unique_ptr<std::thread> &clock_thread,
+               std::shared_ptr<Debugger> &debugger, const std::shared_ptr<Movie> &movie)
 {
     static Programs programs("../prog_list.txt");
     static Program *selected_program = &programs.programs[0];
 
+    // The local ROM library is mapped rather than read, so it's ready right away however big it is
+    static RomLibrary library = []
+    {
+        RomLibrary library;
+        const char *path = std::getenv("CHIP8_LIBRARY");
+        library.open(path ? path : "../rom_library.c8lib");
+        return library;
+    }();
+    static std::unique_ptr<Program> library_program;
+
+    // Fill the ROM cache in the background so Go doesn't have to wait on a download
+    static Prefetcher prefetcher(RomCache::shared(), programs.programs);
+
     ImGui::Begin("Main Menu", NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse);
-    ImGui::SetWindowSize(ImVec2(450, 100));
-    ImGui::SetWindowPos(ImVec2((Chip8::SCREEN_WIDTH * Chip8::PIXEL_SIZE - 450) / 2, (Chip8::SCREEN_HEIGHT * Chip8::PIXEL_SIZE - 100) / 2));
+    ImGui::SetWindowSize(ImVec2(450, 200));
+    ImGui::SetWindowPos(ImVec2((Chip8::SCREEN_WIDTH * Display::PIXEL_SIZE - 450) / 2, (Chip8::SCREEN_HEIGHT * Display::PIXEL_SIZE - 200) / 2));
 
     // Display the dropdown of programs
     if (ImGui::BeginCombo("Programs", selected_program->name.c_str()))
@@ -30,6 +52,73 @@ void main_menu(const sf::RenderWindow &window, const std::shared_ptr<Chip8> &chi
         ImGui::EndCombo();
     }
 
+    // Display the dropdown of ROMs in the library, only the ones that are visible are looked at
+    if (library.size() > 0 && ImGui::BeginCombo("Library", library_program ? library_program->name.c_str() : ""))
+    {
+        ImGuiListClipper clipper;
+        clipper.Begin(library.size());
+        while (clipper.Step())
+        {
+            for (int idx = clipper.DisplayStart; idx < clipper.DisplayEnd; idx++)
+            {
+                RomLibrary::Rom rom;
+                if (!library.get(idx, rom))
+                    continue;
+
+                const std::string name(rom.name);
+                ImGui::PushID(idx);
+                if (ImGui::Selectable(name.c_str(), library_program && selected_program == library_program.get() && library_program->name == name))
+                {
+                    // If the library's copy can't be used, the ROM's file is read through the ROM cache instead
+                    library_program = std::make_unique<Program>(name, "file://" + std::string(rom.path));
+                    library.read(idx, library_program->program);
+                    selected_program = library_program.get();
+                }
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    if (!prefetcher.done())
+    {
+        const std::string progress = "Caching ROMs " + std::to_string(prefetcher.get_finished()) + "/" + std::to_string(prefetcher.get_total());
+        ImGui::ProgressBar(static_cast<float>(prefetcher.get_finished()) / prefetcher.get_total(), ImVec2(-1, 0), progress.c_str());
+    }
+    else if (prefetcher.get_failed() > 0)
+    {
+        ImGui::Text("%zu ROMs couldn't be cached", prefetcher.get_failed());
+    }
+
+    // Set how fast the CPU runs, turbo can also be toggled with tab once the program is running
+    int instructions_per_second = scheduler->get_instructions_per_second();
+    if (ImGui::InputInt("Instructions/s", &instructions_per_second, 100, 1000))
+        scheduler->set_instructions_per_second(std::max(instructions_per_second, 1));
+
+    ImGui::SameLine();
+    bool turbo = scheduler->get_turbo();
+    if (ImGui::Checkbox("Turbo", &turbo))
+        scheduler->set_turbo(turbo);
+
+    // Recording frames to rewind to, rewinding is done by holding backspace once the program is running
+    ImGui::SameLine();
+    bool rewind_enabled = scheduler->get_rewind_enabled();
+    if (ImGui::Checkbox("Rewind", &rewind_enabled))
+        scheduler->set_rewind_enabled(rewind_enabled);
+
+    // Choose how instructions are executed, the debugger always uses the interpreter
+    if (ImGui::RadioButton("Interpreter", chip8->get_engine() == Engine::Interpreter))
+        chip8->set_engine(Engine::Interpreter);
+    ImGui::SameLine();
+    if (ImGui::RadioButton("Threaded", chip8->get_engine() == Engine::Threaded))
+        chip8->set_engine(Engine::Threaded);
+    if (chip8->jit_available())
+    {
+        ImGui::SameLine();
+        if (ImGui::RadioButton("JIT", chip8->get_engine() == Engine::Jit))
+            chip8->set_engine(Engine::Jit);
+    }
+
     // Enable/Disable the debugger
     if (ImGui::Button(debugger ? "Disable Debugger" : "Enable Debugger"))
     {
@@ -47,13 +136,63 @@ void main_menu(const sf::RenderWindow &window, const std::shared_ptr<Chip8> &chi
         ImGui::Checkbox("Break on Start", &break_next);
     }
 
-    // Load the program and start the CPU
-    if (ImGui::Button("Go"))
+    // Get the program in the background, since it might have to be downloaded, and only start the CPU once it's ready
+    // The task works on its own copy of the program so changing the selection can't pull it out from under it
+    // curl was set up by main before any thread started, so the task can use it alongside the prefetcher
+    static std::future<Program> loading;
+    static std::string load_error;
+    if (!loading.valid())
     {
-        chip8->load_program(selected_program);
-        if (debugger)
-            chip8->attach_debugger(debugger, break_next);
-        clock_thread = create_clock_thread(window, chip8);
+        if (ImGui::Button("Go"))
+        {
+            load_error.clear();
+            loading = std::async(std::launch::async, [program = *selected_program]() mutable
+                                 {
+                                     program.get_program();
+                                     return program;
+                                 });
+        }
+    }
+    else if (loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        static constexpr const char SPINNER[] = "|/-\\";
+        ImGui::Text("Loading %c", SPINNER[static_cast<int>(ImGui::GetTime() * 8) % 4]);
+    }
+    else
+    {
+        const Program loaded = loading.get();
+        if (loaded.program.empty())
+        {
+            load_error = loaded.error.empty() ? loaded.name + " is empty" : loaded.error;
+        }
+        else
+        {
+            chip8->load_program(loaded.program);
+            if (debugger)
+            {
+                Chip8 *target = chip8.get();
+                debugger->attach(chip8->get_memory(), chip8->get_registers(), chip8->get_generations(), break_next, [target](addr_t addr, size_t length)
+                                 { target->queue_memory_written(addr, length); });
+                chip8->set_clock_handler(debugger);
+                chip8->set_profile(debugger->get_profile());
+                chip8->set_trace(debugger->get_trace());
+            }
+
+            // Record every key event from the first instruction on
+            if (movie)
+            {
+                movie->rom_hash = Movie::hash_rom(loaded.program);
+                movie->instructions_per_second = scheduler->get_instructions_per_second();
+                keypad->get_state()->record(&movie->events);
+            }
+            clock_thread = create_clock_thread(window, chip8, scheduler);
+        }
+    }
+
+    if (!load_error.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1, 0.4f, 0.4f, 1), "%s", load_error.c_str());
     }
 
     ImGui::End();
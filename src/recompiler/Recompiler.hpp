@@ -0,0 +1,563 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../core/Decoder.hpp"
+#include "../core/Disassembler.hpp"
+#include "../core/RecompiledEngine.hpp"
+#include "../core/font.hpp"
+#include "../core/types.hpp"
+
+// Traces the code reachable from 0x200 in a ROM and turns it into a C++ translation unit, one function per basic block
+// Blocks keep the general registers and I in locals, instructions with side effects outside of the registers go through RecompiledEngine::execute
+class Recompiler
+{
+private:
+    struct Block
+    {
+        addr_t start;
+        addr_t end;
+        std::vector<DecodedInstruction> instructions;
+    };
+
+    std::string name;
+    std::vector<byte> rom;
+
+    // Memory as it is right after the ROM is loaded
+    std::array<byte, 0x1000> memory{};
+
+    // Every address a block starts at
+    std::set<addr_t> leaders;
+
+    std::vector<Block> blocks;
+
+    [[nodiscard]] inst_t fetch(addr_t addr) const
+    {
+        return (memory[addr] << 8) | memory[addr + 1];
+    }
+
+    // Whether an instruction starting at the address fits in memory
+    [[nodiscard]] static bool in_memory(addr_t addr)
+    {
+        return addr < 0xFFF;
+    }
+
+    // Follow every path through the code from 0x200, recording the addresses blocks have to start at
+    void trace()
+    {
+        std::bitset<0x1000> visited;
+        std::vector<addr_t> pending{0x200};
+        leaders.insert(0x200);
+
+        const auto branch = [&](addr_t target)
+        {
+            target &= 0xFFF;
+            if (in_memory(target) && leaders.insert(target).second)
+                pending.push_back(target);
+        };
+
+        while (!pending.empty())
+        {
+            addr_t addr = pending.back();
+            pending.pop_back();
+
+            while (in_memory(addr) && !visited[addr])
+            {
+                visited[addr] = true;
+                const DecodedInstruction instruction = decode(fetch(addr));
+
+                bool done = true;
+                switch (instruction.op)
+                {
+                case Op::JP:
+                    branch(instruction.nnn);
+                    break;
+                case Op::CALL:
+                    branch(instruction.nnn);
+                    branch(addr + 2);
+                    break;
+                case Op::SE_BYTE:
+                case Op::SNE_BYTE:
+                case Op::SE_REG:
+                case Op::SNE_REG:
+                case Op::SKP:
+                case Op::SKNP:
+                    branch(addr + 2);
+                    branch(addr + 4);
+                    break;
+                case Op::LD_VX_K:
+                case Op::LD_B:
+                case Op::LD_MEM_VX:
+                    // Waiting for a key is left to the interpreter, and writing memory could change the code after it
+                    branch(addr + 2);
+                    break;
+                case Op::RET:
+                case Op::JP_V0:
+                case Op::Invalid:
+                    // Where these go can't be known ahead of time
+                    break;
+                default:
+                    done = false;
+                    break;
+                }
+
+                if (done)
+                    break;
+                addr += 2;
+            }
+        }
+    }
+
+    // Whether an instruction is run by generated code instead of through RecompiledEngine::execute
+    [[nodiscard]] static bool generated(Op op)
+    {
+        switch (op)
+        {
+        case Op::JP:
+        case Op::SE_BYTE:
+        case Op::SNE_BYTE:
+        case Op::SE_REG:
+        case Op::SNE_REG:
+        case Op::LD_BYTE:
+        case Op::ADD_BYTE:
+        case Op::LD_REG:
+        case Op::OR:
+        case Op::AND:
+        case Op::XOR:
+        case Op::ADD_REG:
+        case Op::SUB:
+        case Op::SHR:
+        case Op::SUBN:
+        case Op::SHL:
+        case Op::LD_I:
+        case Op::LD_VX_DT:
+        case Op::LD_DT_VX:
+        case Op::LD_ST_VX:
+        case Op::ADD_I:
+        case Op::LD_F:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Whether an instruction is the last in its block
+    [[nodiscard]] static bool ends_block(Op op)
+    {
+        switch (op)
+        {
+        case Op::RET:
+        case Op::JP:
+        case Op::CALL:
+        case Op::SE_BYTE:
+        case Op::SNE_BYTE:
+        case Op::SE_REG:
+        case Op::SNE_REG:
+        case Op::JP_V0:
+        case Op::SKP:
+        case Op::SKNP:
+        case Op::LD_B:
+        case Op::LD_MEM_VX:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Split the traced code into blocks, each running from a leader to control flow, a write to memory or the next leader
+    void build_blocks()
+    {
+        // Blocks cut off by the length limit add the rest of their code as another block, so leaders grows while blocks are built
+        std::vector<addr_t> pending(leaders.rbegin(), leaders.rend());
+        while (!pending.empty())
+        {
+            const addr_t start = pending.back();
+            pending.pop_back();
+
+            Block block{start, start, {}};
+            addr_t addr = start;
+            while (in_memory(addr))
+            {
+                const DecodedInstruction instruction = decode(fetch(addr));
+
+                // Both of these are left to the interpreter
+                if (instruction.op == Op::LD_VX_K || instruction.op == Op::Invalid)
+                    break;
+
+                block.instructions.push_back(instruction);
+                addr += 2;
+
+                if (ends_block(instruction.op) || leaders.count(addr))
+                    break;
+
+                if (block.instructions.size() == RecompiledEngine::MAX_BLOCK_LENGTH)
+                {
+                    if (in_memory(addr))
+                    {
+                        leaders.insert(addr);
+                        pending.push_back(addr);
+                    }
+                    break;
+                }
+            }
+            block.end = addr;
+
+            if (!block.instructions.empty())
+                blocks.push_back(block);
+        }
+    }
+
+    [[nodiscard]] static std::string format(const char *format, unsigned int value)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), format, value);
+        return buf;
+    }
+
+    [[nodiscard]] static std::string reg(uint8_t idx)
+    {
+        return format("v%x", idx);
+    }
+
+    [[nodiscard]] static std::string hex(unsigned int value)
+    {
+        return format("0x%X", value);
+    }
+
+    // The general registers an instruction generated inline reads or writes, nothing for ones that go through RecompiledEngine::execute
+    [[nodiscard]] static std::vector<uint8_t> registers_used(const DecodedInstruction &instruction)
+    {
+        switch (instruction.op)
+        {
+        case Op::SE_BYTE:
+        case Op::SNE_BYTE:
+        case Op::LD_BYTE:
+        case Op::ADD_BYTE:
+        case Op::LD_VX_DT:
+        case Op::LD_DT_VX:
+        case Op::LD_ST_VX:
+        case Op::ADD_I:
+        case Op::LD_F:
+            return {instruction.x};
+        case Op::SE_REG:
+        case Op::SNE_REG:
+            // Comparing a register with itself is generated as a plain jump
+            if (instruction.x == instruction.y)
+                return {};
+            return {instruction.x, instruction.y};
+        case Op::LD_REG:
+        case Op::OR:
+        case Op::AND:
+        case Op::XOR:
+            return {instruction.x, instruction.y};
+        case Op::ADD_REG:
+        case Op::SUB:
+        case Op::SHR:
+        case Op::SUBN:
+        case Op::SHL:
+            return {instruction.x, instruction.y, 0xF};
+        default:
+            return {};
+        }
+    }
+
+    // Whether an instruction generated inline changes Vx
+    [[nodiscard]] static bool writes_vx(Op op)
+    {
+        switch (op)
+        {
+        case Op::LD_BYTE:
+        case Op::ADD_BYTE:
+        case Op::LD_REG:
+        case Op::OR:
+        case Op::AND:
+        case Op::XOR:
+        case Op::ADD_REG:
+        case Op::SUB:
+        case Op::SHR:
+        case Op::SUBN:
+        case Op::SHL:
+        case Op::LD_VX_DT:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Whether an instruction generated inline sets VF as a flag
+    [[nodiscard]] static bool writes_vf(Op op)
+    {
+        return op == Op::ADD_REG || op == Op::SUB || op == Op::SHR || op == Op::SUBN || op == Op::SHL;
+    }
+
+    // The C++ for an instruction that's generated inline, each is written the same way as in Instructions.hpp
+    [[nodiscard]] static std::string statement(const DecodedInstruction &instruction)
+    {
+        const std::string vx = reg(instruction.x);
+        const std::string vy = reg(instruction.y);
+        const std::string kk = hex(instruction.kk);
+
+        switch (instruction.op)
+        {
+        case Op::LD_BYTE:
+            return vx + " = " + kk + ";";
+        case Op::ADD_BYTE:
+            return vx + " += " + kk + ";";
+        case Op::LD_REG:
+            return vx + " = " + vy + ";";
+        case Op::OR:
+            return vx + " |= " + vy + ";";
+        case Op::AND:
+            return vx + " &= " + vy + ";";
+        case Op::XOR:
+            return vx + " ^= " + vy + ";";
+        case Op::ADD_REG:
+            return "{ const uint16_t sum = static_cast<uint16_t>(" + vx + ") + static_cast<uint16_t>(" + vy + "); vf = sum > 0xFF ? 1 : 0; " + vx + " = sum; }";
+        case Op::SUB:
+            return "vf = " + vx + " >= " + vy + " ? 1 : 0; " + vx + " -= " + vy + ";";
+        case Op::SHR:
+            return "vf = " + vy + " & 1; " + vx + " = " + vy + " >> 1;";
+        case Op::SUBN:
+            return "vf = " + vy + " >= " + vx + " ? 1 : 0; " + vx + " = " + vy + " - " + vx + ";";
+        case Op::SHL:
+            return "vf = " + vy + " >> 7; " + vx + " = " + vy + " << 1;";
+        case Op::LD_I:
+            return "i = " + hex(instruction.nnn) + ";";
+        case Op::LD_VX_DT:
+            return vx + " = r.delay_reg;";
+        case Op::LD_DT_VX:
+            return "r.delay_reg = " + vx + ";";
+        case Op::LD_ST_VX:
+            return "r.sound_reg = " + vx + ";";
+        case Op::ADD_I:
+            return "i += " + vx + ";";
+        case Op::LD_F:
+            return "i = " + vx + " * 5;";
+        default:
+            return "";
+        }
+    }
+
+    // The name of an Op, for calls to RecompiledEngine::execute
+    [[nodiscard]] static const char *op_name(Op op)
+    {
+        switch (op)
+        {
+        case Op::CLS:
+            return "CLS";
+        case Op::RET:
+            return "RET";
+        case Op::CALL:
+            return "CALL";
+        case Op::JP_V0:
+            return "JP_V0";
+        case Op::RND:
+            return "RND";
+        case Op::DRW:
+            return "DRW";
+        case Op::SKP:
+            return "SKP";
+        case Op::SKNP:
+            return "SKNP";
+        case Op::LD_B:
+            return "LD_B";
+        case Op::LD_MEM_VX:
+            return "LD_MEM_VX";
+        case Op::LD_VX_MEM:
+            return "LD_VX_MEM";
+        default:
+            return nullptr;
+        }
+    }
+
+    void emit_block(std::string &out, const Block &block) const
+    {
+        // The locals each block keeps, and which of them need writing back
+        std::bitset<0x10> used;
+        bool uses_i = false;
+        for (const DecodedInstruction &instruction : block.instructions)
+        {
+            for (uint8_t idx : registers_used(instruction))
+                used[idx] = true;
+            uses_i = uses_i || instruction.op == Op::LD_I || instruction.op == Op::ADD_I || instruction.op == Op::LD_F;
+        }
+
+        std::bitset<0x10> dirty;
+        bool i_dirty = false;
+
+        const auto write_back = [&]()
+        {
+            for (uint8_t idx = 0; idx < 0x10; idx++)
+            {
+                if (dirty[idx])
+                    out += "    r.general_regs[" + hex(idx) + "] = " + reg(idx) + ";\n";
+            }
+            if (i_dirty)
+                out += "    r.addr_reg = i;\n";
+            dirty.reset();
+            i_dirty = false;
+        };
+
+        // Pick up the registers an instruction run through RecompiledEngine::execute changed
+        const auto reload = [&](const DecodedInstruction &instruction)
+        {
+            std::bitset<0x10> changed;
+            if (instruction.op == Op::RND)
+                changed[instruction.x] = true;
+            else if (instruction.op == Op::DRW)
+                changed[0xF] = true;
+            else if (instruction.op == Op::LD_VX_MEM)
+                for (uint8_t idx = 0; idx <= instruction.x; idx++)
+                    changed[idx] = true;
+
+            for (uint8_t idx = 0; idx < 0x10; idx++)
+            {
+                if (used[idx] && changed[idx])
+                    out += "    " + reg(idx) + " = r.general_regs[" + hex(idx) + "];\n";
+            }
+            if (uses_i && instruction.op == Op::LD_VX_MEM)
+                out += "    i = r.addr_reg;\n";
+        };
+
+        out += "// " + format("%03X", block.start) + " - " + format("%03X", block.end - 2) + "\n";
+        out += "void block_" + format("%03X", block.start) + "(Chip8 &chip8)\n{\n";
+        out += "    Registers &r = RecompiledEngine::registers(chip8);\n";
+        for (uint8_t idx = 0; idx < 0x10; idx++)
+        {
+            if (used[idx])
+                out += "    reg_t " + reg(idx) + " = r.general_regs[" + hex(idx) + "];\n";
+        }
+        if (uses_i)
+            out += "    addr_t i = r.addr_reg;\n";
+
+        addr_t addr = block.start;
+        bool terminated = false;
+        for (const DecodedInstruction &instruction : block.instructions)
+        {
+            const std::optional<Instruction> disassembled = disassemble_instruction(fetch(addr));
+            out += "\n    // " + format("%03X", addr) + ": " + (disassembled ? static_cast<std::string>(*disassembled) : "????") + "\n";
+
+            if (instruction.op == Op::JP)
+            {
+                write_back();
+                out += "    r.pc_reg = " + hex(instruction.nnn) + ";\n";
+                terminated = true;
+            }
+            else if (instruction.op == Op::SE_BYTE || instruction.op == Op::SNE_BYTE || instruction.op == Op::SE_REG || instruction.op == Op::SNE_REG)
+            {
+                write_back();
+                const bool skip_if_equal = instruction.op == Op::SE_BYTE || instruction.op == Op::SE_REG;
+                const std::string skip = hex((addr + 4) & 0xFFF);
+                const std::string next = hex((addr + 2) & 0xFFF);
+
+                // A register always equals itself, comparing it would only get a warning out of the compiler
+                if (instruction.op != Op::SE_BYTE && instruction.op != Op::SNE_BYTE && instruction.x == instruction.y)
+                {
+                    out += "    r.pc_reg = " + (skip_if_equal ? skip : next) + ";\n";
+                }
+                else
+                {
+                    const std::string other = instruction.op == Op::SE_BYTE || instruction.op == Op::SNE_BYTE ? hex(instruction.kk) : reg(instruction.y);
+                    out += "    r.pc_reg = " + reg(instruction.x) + (skip_if_equal ? " == " : " != ") + other + " ? " + skip + " : " + next + ";\n";
+                }
+                terminated = true;
+            }
+            else if (generated(instruction.op))
+            {
+                out += "    " + statement(instruction) + "\n";
+                if (writes_vx(instruction.op))
+                    dirty[instruction.x] = true;
+                if (writes_vf(instruction.op))
+                    dirty[0xF] = true;
+                i_dirty = i_dirty || instruction.op == Op::LD_I || instruction.op == Op::ADD_I || instruction.op == Op::LD_F;
+            }
+            else
+            {
+                // Everything else works on the registers in memory
+                write_back();
+                const std::string op = op_name(instruction.op);
+                const std::string decoded = "{Op::" + op + ", " + hex(instruction.x) + ", " + hex(instruction.y) + ", " +
+                                            hex(instruction.n) + ", " + hex(instruction.kk) + ", " + hex(instruction.nnn) + "}";
+                if (ends_block(instruction.op))
+                {
+                    out += "    r.pc_reg = " + hex(addr) + ";\n";
+                    out += "    RecompiledEngine::execute<Op::" + op + ">(chip8, " + decoded + ");\n";
+                    out += "    r.pc_reg = (r.pc_reg + 2) & 0xFFF;\n";
+                    terminated = true;
+                }
+                else
+                {
+                    out += "    RecompiledEngine::execute<Op::" + op + ">(chip8, " + decoded + ");\n";
+                    reload(instruction);
+                }
+            }
+
+            addr += 2;
+        }
+
+        if (!terminated)
+        {
+            out += "\n";
+            write_back();
+            out += "    r.pc_reg = " + hex(block.end & 0xFFF) + ";\n";
+        }
+
+        out += "}\n\n";
+    }
+
+public:
+    Recompiler(const std::string &name, const std::vector<byte> &rom) : name(name), rom(rom)
+    {
+        std::copy(font.begin(), font.end(), memory.begin());
+        std::copy(rom.begin(), rom.begin() + std::min(rom.size(), memory.size() - 0x200), memory.begin() + 0x200);
+
+        trace();
+        build_blocks();
+    }
+
+    [[nodiscard]] size_t block_count() const
+    {
+        return blocks.size();
+    }
+
+    // The generated translation unit, registering the program with RecompiledEngine when it's linked in
+    [[nodiscard]] std::string generate() const
+    {
+        std::string out;
+        out += "// Recompiled from " + name + " by chip8_recompile, don't edit\n";
+        out += "#include \"core/RecompiledEngine.hpp\"\n\n";
+        out += "namespace\n{\n";
+
+        for (const Block &block : blocks)
+            emit_block(out, block);
+
+        out += "const byte rom[] = {";
+        for (size_t idx = 0; idx < rom.size(); idx++)
+            out += (idx % 16 ? " " : "\n    ") + format("0x%02X", rom[idx]) + ",";
+        out += "\n};\n\n";
+
+        out += "const RecompiledBlock blocks[] = {\n";
+        for (const Block &block : blocks)
+            out += "    {" + hex(block.start) + ", " + hex(block.end) + ", " + std::to_string(block.instructions.size()) + ", block_" + format("%03X", block.start) + "},\n";
+        out += "};\n\n";
+
+        std::string escaped;
+        for (char c : name)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+
+        out += "const RecompiledProgram program{\"" + escaped + "\", rom, sizeof(rom), blocks, sizeof(blocks) / sizeof(blocks[0])};\n";
+        out += "const RecompiledEngine::Registration registration(program);\n";
+        out += "}\n";
+        return out;
+    }
+};
@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "./Recompiler.hpp"
+
+// Recompiles a ROM ahead of time into a C++ translation unit
+// Usage: chip8_recompile rom.ch8 [-o out.cpp]
+// Linking the output into a program registers it with RecompiledEngine, which then runs it whenever the same ROM is loaded
+
+int main(int argc, char **argv)
+{
+    const char *rom_path = nullptr;
+    const char *output_path = nullptr;
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "-o") && idx + 1 < argc)
+        {
+            output_path = argv[++idx];
+        }
+        else if (argv[idx][0] == '-' || rom_path)
+        {
+            fprintf(stderr, "Usage: %s rom.ch8 [-o out.cpp]\n", argv[0]);
+            return 1;
+        }
+        else
+        {
+            rom_path = argv[idx];
+        }
+    }
+
+    if (!rom_path)
+    {
+        fprintf(stderr, "Usage: %s rom.ch8 [-o out.cpp]\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream stream(rom_path, std::ios::binary);
+    if (!stream)
+    {
+        fprintf(stderr, "Couldn't read %s\n", rom_path);
+        return 1;
+    }
+    const std::vector<byte> rom((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    // The ROM's file name is what the program is called, without the directories leading up to it
+    std::string name = rom_path;
+    const size_t slash = name.find_last_of("/\\");
+    if (slash != std::string::npos)
+        name = name.substr(slash + 1);
+
+    const Recompiler recompiler(name, rom);
+    if (rom.empty() || recompiler.block_count() == 0)
+    {
+        fprintf(stderr, "No code found in %s\n", rom_path);
+        return 1;
+    }
+
+    const std::string code = recompiler.generate();
+    if (output_path)
+    {
+        std::ofstream output(output_path, std::ios::binary);
+        output << code;
+        if (!output)
+        {
+            fprintf(stderr, "Couldn't write %s\n", output_path);
+            return 1;
+        }
+    }
+    else
+    {
+        fwrite(code.data(), 1, code.size(), stdout);
+    }
+
+    fprintf(stderr, "%s: %zu blocks\n", name.c_str(), recompiler.block_count());
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../core/Breakpoints.hpp"
+
+// Checks breakpoint conditions parse the way the debugger describes them, and hold when they should
+// Exits with 1 and prints every condition that didn't
+
+int main()
+{
+    Registers registers;
+    registers.general_regs[3] = 0x10;
+    registers.general_regs[0xA] = 8;
+    registers.addr_reg = 0xE20;
+    registers.delay_reg = 0;
+    registers.pc_reg = 0x2F0;
+
+    struct Case
+    {
+        const char *text;
+        // Nothing when the text shouldn't parse
+        std::optional<bool> holds;
+    };
+
+    const std::vector<Case> cases{
+        {"V3 == 0x10", true},
+        {"v3 == 0X10", true},
+        {"V3 == 16", true},
+        {"I > 0xE00", true},
+        {"I > 0xE20", false},
+        {"PC <= 0x2F0 && DT == 0", true},
+        {"V3 == 0x10 && I > 0xE00 && VA != 8", false},
+        {"V3==0x10&&VA>=8", true},
+        // A leading 0 is decimal, not octal
+        {"VA == 010", false},
+        {"VA == 08", true},
+        {"VA == 0", false},
+        {"0xFFFF >= V3", true},
+        {"", std::nullopt},
+        {"V3", std::nullopt},
+        {"V3 ==", std::nullopt},
+        {"V3 = 1", std::nullopt},
+        {"V3 == 0x", std::nullopt},
+        {"V3 == 0xG", std::nullopt},
+        {"V3 == -1", std::nullopt},
+        {"V3 == +1", std::nullopt},
+        {"V3 == 0x10000", std::nullopt},
+        {"V3 == 1 &&", std::nullopt},
+        {"V3 == 1 & V4 == 2", std::nullopt},
+        {"VG == 1", std::nullopt},
+        {"V3 == 1 junk", std::nullopt},
+    };
+
+    bool passed = true;
+    for (const Case &test : cases)
+    {
+        const std::optional<Condition> condition = Condition::parse(test.text);
+        if (condition.has_value() != test.holds.has_value())
+        {
+            fprintf(stderr, "\"%s\": %s, expected it to %s\n", test.text, condition ? "parsed" : "didn't parse", test.holds ? "parse" : "be refused");
+            passed = false;
+        }
+        else if (condition && (*condition)(registers) != *test.holds)
+        {
+            fprintf(stderr, "\"%s\": %s, expected it to %s\n", test.text, *test.holds ? "didn't hold" : "held", *test.holds ? "hold" : "not hold");
+            passed = false;
+        }
+    }
+
+    if (!passed)
+        return 1;
+
+    printf("%zu conditions parsed and held as expected\n", cases.size());
+    return 0;
+}
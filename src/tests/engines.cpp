@@ -0,0 +1,264 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "../core/Chip8.hpp"
+#include "../core/Movie.hpp"
+#include "../core/SaveState.hpp"
+#include "./random_rom.hpp"
+
+// Checks that every engine leaves exactly the same state behind as the interpreter, which is the reference
+// The first RECOMPILED_ROMS random ROMs were recompiled at build time and linked in, so the recompiled engine is checked with those
+// Exits with 1 and prints what differed at the first mismatch
+
+#ifndef RECOMPILED_ROMS
+#error "RECOMPILED_ROMS has to be set to how many random ROMs the build recompiled"
+#endif
+
+static constexpr const uint64_t RANDOM_ROMS = 500;
+static constexpr const uint32_t FRAMES = 200;
+static constexpr const uint32_t FRAME_INSTRUCTIONS = 500;
+
+static const char *engine_name(Engine engine)
+{
+    switch (engine)
+    {
+    case Engine::Interpreter:
+        return "interpreter";
+    case Engine::Threaded:
+        return "threaded";
+    case Engine::Jit:
+        return "jit";
+    case Engine::Recompiled:
+        return "recompiled";
+    }
+    return "unknown";
+}
+
+struct Run
+{
+    std::shared_ptr<KeypadState> keypad = std::make_shared<KeypadState>();
+    Chip8 chip8{keypad};
+
+    Run(const std::vector<byte> &rom, uint64_t seed, Engine engine)
+    {
+        chip8.seed(seed);
+        chip8.load_program(rom);
+        chip8.set_engine(engine);
+    }
+};
+
+static bool same_state(const Chip8 &reference, const Chip8 &other, const char *rom, Engine engine, uint32_t frame)
+{
+    SaveState expected;
+    SaveState actual;
+    reference.save_state(expected);
+    other.save_state(actual);
+    if (!std::memcmp(&expected, &actual, sizeof(SaveState)))
+        return true;
+
+    fprintf(stderr, "%s: %s differs from the interpreter after frame %" PRIu32 "\n", rom, engine_name(engine), frame);
+    fprintf(stderr, "  cycles %" PRIu64 " / %" PRIu64 ", pc %03X / %03X, I %03X / %03X, sp %u / %u, state %u / %u\n", expected.cycles, actual.cycles,
+            expected.registers.pc_reg, actual.registers.pc_reg, expected.registers.addr_reg, actual.registers.addr_reg, expected.stack_pointer, actual.stack_pointer,
+            expected.state, actual.state);
+    for (size_t idx = 0; idx < expected.memory.size(); idx++)
+    {
+        if (expected.memory[idx] != actual.memory[idx])
+        {
+            fprintf(stderr, "  first memory difference at %03zX: %02X / %02X\n", idx, expected.memory[idx], actual.memory[idx]);
+            break;
+        }
+    }
+    return false;
+}
+
+// Runs a random ROM on every engine with the same input, comparing them with the interpreter after every frame
+static bool check_random_rom(uint64_t seed, size_t &halted)
+{
+    const std::vector<byte> rom = random_rom(seed);
+    const Movie input = random_input(seed, FRAMES * FRAME_INSTRUCTIONS);
+    char name[32];
+    snprintf(name, sizeof(name), "random ROM %" PRIu64, seed);
+
+    std::vector<std::unique_ptr<Run>> runs;
+    for (Engine engine : {Engine::Interpreter, Engine::Threaded, Engine::Jit, Engine::Recompiled})
+    {
+        std::unique_ptr<Run> run = std::make_unique<Run>(rom, seed, engine);
+        if (engine == Engine::Jit && !run->chip8.jit_available())
+            continue;
+        if (engine == Engine::Recompiled && !run->chip8.recompiled_available())
+        {
+            if (seed < RECOMPILED_ROMS)
+            {
+                fprintf(stderr, "%s: was recompiled at build time but isn't linked in\n", name);
+                return false;
+            }
+            continue;
+        }
+        runs.push_back(std::move(run));
+    }
+
+    std::vector<MoviePlayer> players;
+    for (const std::unique_ptr<Run> &run : runs)
+        players.emplace_back(input, run->keypad);
+
+    for (uint32_t frame = 0; frame < FRAMES; frame++)
+    {
+        for (size_t idx = 0; idx < runs.size(); idx++)
+        {
+            players[idx].run(runs[idx]->chip8, FRAME_INSTRUCTIONS);
+            runs[idx]->chip8.tick_timers();
+        }
+
+        for (size_t idx = 1; idx < runs.size(); idx++)
+        {
+            if (!same_state(runs[0]->chip8, runs[idx]->chip8, name, runs[idx]->chip8.get_engine(), frame))
+                return false;
+        }
+
+        if (runs[0]->chip8.halted())
+        {
+            halted++;
+            break;
+        }
+    }
+    return true;
+}
+
+// ROMs built around the sequences the threaded engine fuses, which random ROMs almost never contain
+// Runs get budgets from 1 to 7 instructions, so they end in the middle of fused sequences as well as between them
+static bool check_fused()
+{
+    struct Case
+    {
+        const char *name;
+        std::vector<byte> rom;
+    };
+
+    const std::vector<Case> cases{
+        // LD VA, 5 and LD DT, VA, then LD VB, DT, SE VB, 2 and JP back to the LD VB, DT until the timer counts down to 2, count it in V0 and start again
+        {"delay timer poll", {0x6A, 0x05, 0xFA, 0x15, 0xFB, 0x07, 0x3B, 0x02, 0x12, 0x04, 0x70, 0x01, 0x12, 0x00}},
+        // The same waiting for the timer to run out, so the poll sees it at zero, with a fused LD V1, 3 and LD DT, V1 between two ADDs
+        {"delay timer poll to zero", {0x70, 0x01, 0x61, 0x03, 0xF1, 0x15, 0x72, 0x01, 0xF3, 0x07, 0x33, 0x00, 0x12, 0x08, 0x12, 0x00}},
+        // A fused pair in a straight line loop with no polling, so most runs stop somewhere inside it
+        {"delay timer load", {0x70, 0x01, 0x61, 0x07, 0xF1, 0x15, 0x72, 0x01, 0x12, 0x00}},
+    };
+
+    bool passed = true;
+    for (const Case &test : cases)
+    {
+        std::vector<std::unique_ptr<Run>> runs;
+        for (Engine engine : {Engine::Interpreter, Engine::Threaded, Engine::Jit})
+        {
+            std::unique_ptr<Run> run = std::make_unique<Run>(test.rom, 0, engine);
+            if (engine == Engine::Jit && !run->chip8.jit_available())
+                continue;
+            runs.push_back(std::move(run));
+        }
+
+        for (uint32_t frame = 0; frame < FRAMES && passed; frame++)
+        {
+            const uint32_t budget = 1 + frame % 7;
+            for (const std::unique_ptr<Run> &run : runs)
+            {
+                run->chip8.run(budget);
+                run->chip8.tick_timers();
+            }
+
+            for (size_t idx = 1; idx < runs.size() && passed; idx++)
+                passed = same_state(runs[0]->chip8, runs[idx]->chip8, test.name, runs[idx]->chip8.get_engine(), frame);
+        }
+
+        // Every ROM has to have got through its poll loop a few times for the test to mean anything
+        if (passed && runs[0]->chip8.get_registers()->general_regs[0] < 3)
+        {
+            fprintf(stderr, "%s: only went around %u times\n", test.name, runs[0]->chip8.get_registers()->general_regs[0]);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+// Invalid instructions, 0nnn and data included, stop the Chip 8 on them on every engine
+static bool check_halting()
+{
+    struct Case
+    {
+        const char *name;
+        std::vector<byte> rom;
+        // How many instructions run before halting, including the invalid one, and where it is
+        uint32_t executed;
+        addr_t pc;
+    };
+
+    const std::vector<Case> cases{
+        // LD V0, 5 then SYS 123
+        {"0nnn", {0x60, 0x05, 0x01, 0x23}, 2, 0x202},
+        // ADD V0, 1 twice then 0000, the threaded engine would have put all three in one block
+        {"end of block", {0x70, 0x01, 0x70, 0x01, 0x00, 0x00}, 3, 0x204},
+        // Count V0 up to FF in a loop hot enough for the JIT, then fall into data
+        {"after hot loop", {0x70, 0x01, 0x30, 0xFF, 0x12, 0x00, 0xFF, 0xFF}, 254 * 3 + 3, 0x206},
+        // Running off the end of the ROM into empty memory
+        {"empty memory", {0x60, 0x01}, 2, 0x202},
+    };
+
+    bool passed = true;
+    for (const Case &test : cases)
+    {
+        for (Engine engine : {Engine::Interpreter, Engine::Threaded, Engine::Jit})
+        {
+            Run run(test.rom, 0, engine);
+            const uint32_t executed = run.chip8.run(10000);
+            const uint32_t again = run.chip8.run(10000);
+            const addr_t pc = run.chip8.get_registers()->pc_reg;
+            if (!run.chip8.halted() || executed != test.executed || again != 0 || pc != test.pc || run.chip8.get_cycles() != test.executed)
+            {
+                fprintf(stderr, "%s on %s: halted %d after %" PRIu32 " instructions at %03X, then ran %" PRIu32 " more, expected %" PRIu32 " at %03X\n", test.name,
+                        engine_name(engine), run.chip8.halted(), executed, pc, again, test.executed, test.pc);
+                passed = false;
+            }
+        }
+
+        // Single clocks stop the same way
+        Run clocked(test.rom, 0, Engine::Interpreter);
+        for (uint32_t idx = 0; idx < test.executed + 10; idx++)
+            clocked.chip8.clock();
+        if (!clocked.chip8.halted() || clocked.chip8.get_cycles() != test.executed)
+        {
+            fprintf(stderr, "%s with clock: halted %d after %" PRIu64 " instructions, expected %" PRIu32 "\n", test.name, clocked.chip8.halted(), clocked.chip8.get_cycles(),
+                    test.executed);
+            passed = false;
+        }
+
+        // Halting is part of a save state
+        SaveState state;
+        clocked.chip8.save_state(state);
+        Run loaded(test.rom, 0, Engine::Interpreter);
+        loaded.chip8.load_state(state);
+        if (!loaded.chip8.halted() || loaded.chip8.run(100) != 0)
+        {
+            fprintf(stderr, "%s: loading a halted state didn't halt\n", test.name);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+int main()
+{
+    bool passed = check_halting();
+    passed = check_fused() && passed;
+
+    size_t halted = 0;
+    for (uint64_t seed = 0; seed < RANDOM_ROMS && passed; seed++)
+        passed = check_random_rom(seed, halted);
+
+    if (!passed)
+        return 1;
+
+    printf("Every engine matched the interpreter on %" PRIu64 " random ROMs, %zu of them halted\n", RANDOM_ROMS, halted);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "../core/KeypadState.hpp"
+
+// Checks key releases from live input survive a full event queue and stay in order with the events around them
+// Exits with 1 and prints every check that failed
+
+static constexpr const uint8_t KEY = 3;
+static constexpr const uint8_t FILLER = 1;
+
+// Fill the rest of the queue with presses and releases of the filler key, stamped with the cycle
+static void fill(KeypadState &keypad, uint64_t cycle)
+{
+    for (bool down = true; keypad.push(FILLER, down, cycle); down = !down)
+    {
+    }
+}
+
+static bool check(const char *name, const KeypadState &keypad, uint16_t keys, const std::vector<KeyEvent> &recorded, const std::vector<KeyEvent> &tail)
+{
+    bool passed = true;
+    if ((keypad.get_keys() & 1 << KEY) != (keys & 1 << KEY))
+    {
+        fprintf(stderr, "%s: key %u is %s\n", name, KEY, keypad.is_key_down(KEY) ? "down" : "up");
+        passed = false;
+    }
+
+    // The events for the key at the end of what was recorded, fillers left out
+    std::vector<KeyEvent> events;
+    for (const KeyEvent &event : recorded)
+    {
+        if (event.key == KEY)
+            events.push_back(event);
+    }
+    if (events.size() < tail.size())
+    {
+        fprintf(stderr, "%s: recorded %zu events for the key, expected at least %zu\n", name, events.size(), tail.size());
+        return false;
+    }
+    for (size_t idx = 0; idx < tail.size(); idx++)
+    {
+        const KeyEvent &actual = events[events.size() - tail.size() + idx];
+        if (actual.cycle != tail[idx].cycle || actual.down != tail[idx].down)
+        {
+            fprintf(stderr, "%s: event %zu from the end is %s at %" PRIu64 ", expected %s at %" PRIu64 "\n", name, tail.size() - idx, actual.down ? "press" : "release",
+                    actual.cycle, tail[idx].down ? "press" : "release", tail[idx].cycle);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+int main()
+{
+    bool passed = true;
+
+    // The release is dropped and applied once the queue is read, after everything in it
+    {
+        KeypadState keypad;
+        std::vector<KeyEvent> recorded;
+        keypad.record(&recorded);
+        keypad.push(KEY, true);
+        fill(keypad, 0);
+        if (!keypad.push(KEY, false))
+        {
+            fprintf(stderr, "dropped release: push said the release was lost\n");
+            passed = false;
+        }
+        keypad.apply_events(10);
+        passed &= check("dropped release", keypad, 0, recorded, {{10, KEY, true}, {10, KEY, false}});
+        if (recorded.size() != KeypadState::EVENT_CAPACITY + 1)
+        {
+            fprintf(stderr, "dropped release: recorded %zu events, expected %zu\n", recorded.size(), KeypadState::EVENT_CAPACITY + 1);
+            passed = false;
+        }
+    }
+
+    // Pressing again before the consumer gets to the release queues the release ahead of the press
+    {
+        KeypadState keypad;
+        std::vector<KeyEvent> recorded;
+        keypad.record(&recorded);
+        keypad.push(KEY, true, 0);
+        keypad.push(FILLER, true, 0);
+        keypad.push(FILLER, false, 0);
+        fill(keypad, 20);
+        keypad.push(KEY, false);
+        // Only what's for now is applied, which makes room again, but the release is behind the events for later
+        keypad.apply_events(0);
+        passed &= check("press before release is reached", keypad, 1 << KEY, recorded, {{0, KEY, true}});
+        keypad.push(KEY, true);
+        keypad.apply_events(20);
+        passed &= check("press after release is reached", keypad, 1 << KEY, recorded, {{0, KEY, true}, {20, KEY, false}, {20, KEY, true}});
+    }
+
+    // Once the consumer has taken the release, a new press is queued after it as normal
+    {
+        KeypadState keypad;
+        std::vector<KeyEvent> recorded;
+        keypad.record(&recorded);
+        keypad.push(KEY, true);
+        fill(keypad, 0);
+        keypad.push(KEY, false);
+        keypad.apply_events(5);
+        keypad.push(KEY, true);
+        keypad.apply_events(6);
+        passed &= check("press after release is applied", keypad, 1 << KEY, recorded, {{5, KEY, true}, {5, KEY, false}, {6, KEY, true}});
+    }
+
+    // With no room for the release and the press, the press is dropped and the release still happens
+    {
+        KeypadState keypad;
+        std::vector<KeyEvent> recorded;
+        keypad.record(&recorded);
+        keypad.push(KEY, true);
+        fill(keypad, 0);
+        keypad.push(KEY, false);
+        if (keypad.push(KEY, true))
+        {
+            fprintf(stderr, "press with no room: push said the press was queued\n");
+            passed = false;
+        }
+        keypad.apply_events(1);
+        passed &= check("press with no room", keypad, 0, recorded, {{1, KEY, true}, {1, KEY, false}});
+    }
+
+    // The release waits behind events queued for later, then goes before anything queued after it
+    {
+        KeypadState keypad;
+        std::vector<KeyEvent> recorded;
+        keypad.record(&recorded);
+        keypad.push(KEY, true, 0);
+        fill(keypad, 50);
+        keypad.push(KEY, false);
+        keypad.apply_events(0);
+        passed &= check("release behind later events", keypad, 1 << KEY, recorded, {{0, KEY, true}});
+        keypad.apply_events(49);
+        passed &= check("release still behind later events", keypad, 1 << KEY, recorded, {{0, KEY, true}});
+        keypad.apply_events(50);
+        passed &= check("release after later events", keypad, 0, recorded, {{0, KEY, true}, {50, KEY, false}});
+        if (recorded.back().key != KEY)
+        {
+            fprintf(stderr, "release after later events: was applied before the events queued ahead of it\n");
+            passed = false;
+        }
+    }
+
+    if (!passed)
+        return 1;
+
+    printf("Dropped key releases were kept and applied in order\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../core/Decoder.hpp"
+#include "../core/Movie.hpp"
+#include "../core/Random.hpp"
+#include "../core/types.hpp"
+
+// A ROM filling all of memory after 0x200 with random instructions, the same every time for the same seed
+// Nearly all of them are valid, with the odd invalid one so halting gets compared too, and more turn up from self modification and odd jumps
+static inline std::vector<byte> random_rom(uint64_t seed)
+{
+    Random random(seed);
+    std::vector<byte> rom;
+    while (rom.size() < 0x1000 - 0x200)
+    {
+        inst_t instruction = random.next() >> 48;
+        const Op op = decode(instruction).op;
+        if (op == Op::Invalid && random.next() % 512 != 0)
+            continue;
+
+        // Returns mostly pop a return address no call pushed, so only keep a few
+        if (op == Op::RET && random.next() % 16 != 0)
+            continue;
+
+        // Jumps and calls land on an instruction in the ROM, so most ROMs run for a while before reaching an invalid one
+        if (op == Op::JP || op == Op::CALL || op == Op::JP_V0)
+            instruction = (instruction & 0xF000) | (0x200 + ((instruction & 0xFFF) % 0xE00 & ~1));
+
+        rom.push_back(instruction >> 8);
+        rom.push_back(instruction & 0xFF);
+    }
+    return rom;
+}
+
+// A key goes down and comes back up every few hundred instructions, so Fx0A, Ex9E and ExA1 see input
+static inline Movie random_input(uint64_t seed, uint64_t cycles)
+{
+    Movie movie;
+    Random random(seed);
+    for (uint64_t cycle = 100; cycle + 150 < cycles; cycle += 400)
+    {
+        const uint8_t key = random.next_byte() & 0xF;
+        movie.events.push_back({cycle, key, true});
+        movie.events.push_back({cycle + 150, key, false});
+    }
+    return movie;
+}
@@ -0,0 +1,147 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../core/Chip8.hpp"
+#include "../core/SaveState.hpp"
+#include "./random_rom.hpp"
+
+// Checks save state files come back exactly as they were written, and that damaged or foreign ones are refused
+// Exits with 1 and prints every check that failed
+
+static const std::string PATH = "save_state_test.c8s";
+
+static std::vector<byte> read_bytes(const std::string &path)
+{
+    std::vector<byte> bytes;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return bytes;
+    for (int value; (value = fgetc(file)) != EOF;)
+        bytes.push_back(value);
+    fclose(file);
+    return bytes;
+}
+
+static void write_bytes(const std::string &path, const std::vector<byte> &bytes)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+// A state from a random ROM that has run for a while, so most of it isn't zero
+static SaveState warm_state()
+{
+    Chip8 chip8(std::make_shared<KeypadState>());
+    chip8.seed(7);
+    chip8.load_program(random_rom(7));
+    for (int frame = 0; frame < 10 && !chip8.halted(); frame++)
+    {
+        chip8.run(100);
+        chip8.tick_timers();
+    }
+
+    SaveState state;
+    chip8.save_state(state);
+    return state;
+}
+
+// Reading the file has to fail and leave the state it was reading into alone
+static bool refused(const char *name)
+{
+    SaveState untouched;
+    untouched.cycles = 1234;
+    SaveState state = untouched;
+    if (read_save_state(PATH, state))
+    {
+        fprintf(stderr, "%s: was read\n", name);
+        return false;
+    }
+    if (std::memcmp(&state, &untouched, sizeof(SaveState)))
+    {
+        fprintf(stderr, "%s: changed the state it was read into\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    const SaveState state = warm_state();
+
+    // Round trip through a file and back into a Chip 8
+    SaveState read;
+    if (!write_save_state(PATH, state) || !read_save_state(PATH, read) || std::memcmp(&state, &read, sizeof(SaveState)))
+    {
+        fprintf(stderr, "round trip: didn't read back what was written\n");
+        passed = false;
+    }
+    else
+    {
+        Chip8 chip8(std::make_shared<KeypadState>());
+        chip8.load_state(read);
+        SaveState saved;
+        chip8.save_state(saved);
+        if (std::memcmp(&state, &saved, sizeof(SaveState)))
+        {
+            fprintf(stderr, "round trip: loading the state and saving it again changed it\n");
+            passed = false;
+        }
+    }
+
+    const std::vector<byte> file = read_bytes(PATH);
+    if (file.size() != sizeof(SaveState) + sizeof(uint64_t))
+    {
+        fprintf(stderr, "file is %zu bytes, expected %zu\n", file.size(), sizeof(SaveState) + sizeof(uint64_t));
+        passed = false;
+    }
+
+    // A flipped bit in the memory no longer matches the checksum
+    std::vector<byte> corrupted = file;
+    corrupted[offsetof(SaveState, memory) + 0x300] ^= 0x10;
+    write_bytes(PATH, corrupted);
+    passed &= refused("corrupted memory");
+
+    // And neither does a flipped bit in the checksum itself
+    corrupted = file;
+    corrupted.back() ^= 0x01;
+    write_bytes(PATH, corrupted);
+    passed &= refused("corrupted checksum");
+
+    // States from another version are refused even with a valid checksum
+    SaveState other_version = state;
+    other_version.version = SaveState::VERSION + 1;
+    write_save_state(PATH, other_version);
+    passed &= refused("wrong version");
+
+    SaveState wrong_magic = state;
+    wrong_magic.magic = 0;
+    write_save_state(PATH, wrong_magic);
+    passed &= refused("wrong magic");
+
+    // Cut off at the checksum, inside the state and with a byte too many
+    write_bytes(PATH, std::vector<byte>(file.begin(), file.begin() + sizeof(SaveState)));
+    passed &= refused("truncated checksum");
+    write_bytes(PATH, std::vector<byte>(file.begin(), file.begin() + sizeof(SaveState) / 2));
+    passed &= refused("truncated state");
+    write_bytes(PATH, {});
+    passed &= refused("empty file");
+    std::vector<byte> extended = file;
+    extended.push_back(0);
+    write_bytes(PATH, extended);
+    passed &= refused("trailing byte");
+
+    std::remove(PATH.c_str());
+    passed &= refused("missing file");
+
+    if (!passed)
+        return 1;
+
+    printf("Save state files read back and damaged ones were refused\n");
+    return 0;
+}
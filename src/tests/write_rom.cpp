@@ -0,0 +1,24 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "../files.hpp"
+#include "./random_rom.hpp"
+
+// Writes the random ROM for a seed, so the build can recompile it into chip8_engine_test
+// Usage: chip8_test_rom seed out.ch8
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s seed out.ch8\n", argv[0]);
+        return 1;
+    }
+
+    const std::vector<byte> rom = random_rom(std::strtoull(argv[1], nullptr, 0));
+    if (!write_file_atomically(argv[2], rom.data(), rom.size()))
+    {
+        fprintf(stderr, "Couldn't write %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
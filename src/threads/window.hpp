@@ -1,12 +1,17 @@
 #pragma once
 
+#include <chrono>
 #include <thread>
 
-#include "../Chip8.hpp"
+#include "../core/Chip8.hpp"
+#include "../core/Movie.hpp"
+#include "../core/Scheduler.hpp"
+#include "../Display.hpp"
 #include "../Keypad.hpp"
 #include "../main_menu.hpp"
+#include "../MetricsOverlay.hpp"
 
-std::unique_ptr<std::thread> create_window_thread(sf::RenderWindow &window, const std::shared_ptr<Keypad> &keypad, const std::shared_ptr<Chip8> &chip8, std::unique_ptr<std::thread> &clock_thread, std::shared_ptr<Debugger> &debugger)
+std::unique_ptr<std::thread> create_window_thread(sf::RenderWindow &window, const std::shared_ptr<Keypad> &keypad, const std::shared_ptr<Chip8> &chip8, const std::shared_ptr<Scheduler> &scheduler, std::unique_ptr<std::thread> &clock_thread, std::shared_ptr<Debugger> &debugger, const std::shared_ptr<Movie> &movie)
 {
     // Create a thread to handle drawing the window and handling events
     window.setActive(false);
@@ -14,8 +19,13 @@ std::unique_ptr<std::thread> create_window_thread(sf::RenderWindow &window, cons
                                          {
                                              sf::Clock deltaClock;
                                              window.setActive(true);
+                                             Display display(chip8);
+                                             const std::shared_ptr<Metrics> metrics = chip8->get_metrics();
+                                             MetricsOverlay overlay(metrics);
                                              while (window.isOpen())
                                              {
+                                                 const std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+
                                                  sf::Event event;
                                                  while (window.pollEvent(event))
                                                  {
@@ -27,7 +37,32 @@ std::unique_ptr<std::thread> create_window_thread(sf::RenderWindow &window, cons
                                                          window.close();
                                                          break;
                                                      case sf::Event::KeyPressed:
+                                                         // Tab toggles turbo mode
+                                                         if (event.key.code == sf::Keyboard::Tab)
+                                                         {
+                                                             scheduler->set_turbo(!scheduler->get_turbo());
+                                                             break;
+                                                         }
+                                                         // F3 toggles the metrics overlay
+                                                         if (event.key.code == sf::Keyboard::F3)
+                                                         {
+                                                             overlay.toggle();
+                                                             break;
+                                                         }
+                                                         // Backspace rewinds for as long as it's held
+                                                         if (event.key.code == sf::Keyboard::BackSpace)
+                                                         {
+                                                             scheduler->set_rewinding(true);
+                                                             break;
+                                                         }
+                                                         keypad->handle_key_event(event);
+                                                         break;
                                                      case sf::Event::KeyReleased:
+                                                         if (event.key.code == sf::Keyboard::BackSpace)
+                                                         {
+                                                             scheduler->set_rewinding(false);
+                                                             break;
+                                                         }
                                                          keypad->handle_key_event(event);
                                                          break;
                                                      }
@@ -36,16 +71,32 @@ std::unique_ptr<std::thread> create_window_thread(sf::RenderWindow &window, cons
                                                  ImGui::SFML::Update(window, deltaClock.restart());
 
                                                  if (!clock_thread)
-                                                     main_menu(window, chip8, clock_thread, debugger);
+                                                     main_menu(window, keypad, chip8, scheduler, clock_thread, debugger, movie);
                                                  else if (debugger)
                                                      debugger->draw_debugger();
+                                                 overlay.draw(*scheduler);
 
                                                  // Draw the window
+                                                 const std::chrono::steady_clock::time_point draw_start = std::chrono::steady_clock::now();
+                                                 display.update();
                                                  window.clear(sf::Color::Black);
-                                                 window.draw(*chip8);
+                                                 window.draw(display);
+                                                 Metrics::add(metrics->draw_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - draw_start).count());
                                                  window.draw(*keypad);
                                                  ImGui::SFML::Render(window);
+
+                                                 // The display and keypad, and then whatever ImGui drew
+                                                 uint64_t draw_calls = 2;
+                                                 if (const ImDrawData *draw_data = ImGui::GetDrawData())
+                                                 {
+                                                     for (int idx = 0; idx < draw_data->CmdListsCount; idx++)
+                                                         draw_calls += draw_data->CmdLists[idx]->CmdBuffer.Size;
+                                                 }
+                                                 Metrics::add(metrics->draw_calls, draw_calls);
+
                                                  window.display();
+                                                 Metrics::add(metrics->window_frames, 1);
+                                                 Metrics::add(metrics->window_frame_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frame_start).count());
                                              }
                                          });
 }
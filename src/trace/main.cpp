@@ -0,0 +1,56 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../core/Disassembler.hpp"
+#include "../core/Trace.hpp"
+
+// Prints a trace dumped by the debugger as text, one executed instruction per line
+// Usage: chip8_trace [--tail N] trace.c8t
+// Each line is the cycle, address, opcode, disassembly, I and the register the instruction wrote
+
+int main(int argc, char **argv)
+{
+    const char *path = nullptr;
+    size_t tail = SIZE_MAX;
+    bool usage = false;
+    for (int idx = 1; idx < argc; idx++)
+    {
+        if (!strcmp(argv[idx], "--tail") && idx + 1 < argc)
+            tail = std::strtoull(argv[++idx], nullptr, 10);
+        else if (argv[idx][0] == '-' || path)
+            usage = true;
+        else
+            path = argv[idx];
+    }
+    if (usage || !path)
+    {
+        fprintf(stderr, "Usage: %s [--tail N] trace.c8t\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<TraceEntry> trace;
+    if (!Trace::read(path, trace))
+    {
+        fprintf(stderr, "%s isn't a trace\n", path);
+        return 1;
+    }
+
+    for (size_t idx = trace.size() > tail ? trace.size() - tail : 0; idx < trace.size(); idx++)
+    {
+        const TraceEntry &entry = trace[idx];
+        const std::optional<Instruction> instruction = disassemble_instruction(entry.opcode);
+        const std::string text = instruction ? static_cast<std::string>(*instruction) : "????";
+
+        printf("%12" PRIu64 "  %03X  %04X  %-16s I=%03X", entry.cycle, entry.pc, entry.opcode, text.c_str(), entry.addr_reg);
+        if (entry.changed != Trace::NO_REGISTER)
+            printf("  V%X=%02X", entry.changed, entry.value);
+        printf("\n");
+    }
+
+    return 0;
+}